@@ -37,7 +37,19 @@ int penaltyMin = 204;
 int penaltyMax = 6922;
 
 // our thread pool
-extern ThreadPool gondor;
+
+// defer moves other threads are searching, and the least depth we bother doing it at
+extern bool abdada;
+constexpr int DEFER_DEPTH = 5;
+
+// the tablebase probes are only timed when someone asked for the numbers
+extern bool debugMode;
+extern bool syzygyStats;
+
+// how often the main thread looks at the clock, and the bounds on how many nodes it waits between looks
+constexpr double POLL_INTERVAL_MS = 1.0;
+constexpr int MIN_POLL_CALLS = 64;
+constexpr int MAX_POLL_CALLS = 1 << 16;
 
 // the other formula simplifies down to this.  This should be easier to tune than 4 separate variables
 void initReductions(double nem, double neb, double tem, double teb) {
@@ -125,6 +137,10 @@ template <Anduril::NodeType nodeType>
 int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int depth) {
     constexpr bool PvNode = nodeType != NonPV;
 
+    if constexpr (PvNode) {
+        clearPV();
+    }
+
     // are we in check?
     bool check = board.in_check();
 
@@ -153,7 +169,7 @@ int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int dept
 
     // transposition lookup
     uint64_t hash = board.hash();
-    Node *node = table.probe(hash, board.found());
+    Node *node = table.probe(hash ^ tag, board.found());
     int nType = board.found() ? node->nodeTypeGenBound & 0x3 : 0;
     int nEval = board.found() ? node->nodeEval : -32001;
     int nDepth = board.found() ? node->nodeDepth : -1;
@@ -164,7 +180,7 @@ int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int dept
         && nScore != -32001
 		&& nDepth >= tDepth
         && (nType & (nScore >= beta ? 2 : 1))) {
-		movesTransposed++;
+		stats.movesTransposed++;
 		return nScore;
 	}
 
@@ -283,7 +299,7 @@ int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int dept
         }
 
         // prefetch before we make a move
-        prefetch(table.firstEntry(board.hashAfter(move)));
+        prefetch(table.firstEntry(board.hashAfter(move) ^ tag));
 
         quietCheckCounter += !isCapture && check;
 
@@ -293,10 +309,10 @@ int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int dept
                                                           [board.piece_on(move.from_square())->value()]
                                                           [move.to_square()];
 
-        movesExplored++;
+        stats.movesExplored++;
         board.make_move(move);
 
-        quiesceExplored++;
+        stats.quiesceExplored++;
         incPly();
         score = -quiescence<nodeType>(board, -beta, -alpha, depth - 1);
         decPly();
@@ -306,11 +322,14 @@ int Anduril::quiescence(libchess::Position &board, int alpha, int beta, int dept
             bestScore = score;
             if (score > alpha) {
                 bestMove = move;
+                if constexpr (PvNode) {
+                    updatePV(move);
+                }
                 if (PvNode && score < beta) {
                     alpha = score;
                 }
                 else {
-                    cutNodes++;
+                    stats.cutNodes++;
                     break;
                 }
             }
@@ -333,6 +352,10 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
     constexpr bool PvNode = nodeType != NonPV;
     constexpr bool rootNode = nodeType == Root;
 
+    if constexpr (PvNode) {
+        clearPV();
+    }
+
     // if we are at max depth, start a quiescence search
     if (depth <= 0){
         return quiescence<PvNode ? PV : NonPV>(board, alpha, beta);
@@ -347,14 +370,24 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
     }
 
     // should we abort the search?
-    if (id == 0 && shouldStop()) {
-        gondor.stop = true;
+    // the clock is only looked at every so often, see checkTime()
+    if (id == 0 && --callsUntilCheck <= 0) {
+        checkTime();
+    }
+
+    // every thread takes its nodes out of the shared budget when there is a node limit
+    if (nodeLimited && stats.movesExplored.load() >= quantumEnd) {
+        int64_t taken = pool.takeNodes();
+        if (taken == 0) {
+            pool.requestStop();
+        }
+        quantumEnd += taken;
     }
 
     // is the time up?  Mate distance pruning?
     if constexpr (!rootNode) {
         // check for aborted search
-        if (gondor.stop) {
+        if (pool.stop) {
             return 0;
         }
 
@@ -364,7 +397,15 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
         // check for a draw, add variance to draw score to avoid 3-fold blindness
         if (board.is_draw()) {
-            return 0 - 1 + (movesExplored.load() & 0x2);
+            return 0 - 1 + (stats.movesExplored.load() & 0x2);
+        }
+
+        // if we can move into a repeated position, we can guarantee at least a draw
+        if (alpha < 0 && board.has_upcoming_repetition(ply - rootPly)) {
+            alpha = 0 - 1 + (stats.movesExplored.load() & 0x2);
+            if (alpha >= beta) {
+                return alpha;
+            }
         }
 
         // Mate distance pruning.  If we mate at the next move, our score would be mate in current ply + 1.  If alpha
@@ -418,7 +459,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
     // transposition lookup
     uint64_t hash = board.hash();
-    Node *node = table.probe(hash, board.found());
+    Node *node = table.probe(hash ^ tag, board.found());
     int nDepth = board.found() ? node->nodeDepth : -99;
     int nType = board.found() ? node->nodeTypeGenBound & 0x3 : 0;
     int nEval = board.found() ? node->nodeEval : -32001;
@@ -433,7 +474,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
         && excludedMove.value() == 0
 		&& nDepth >= depth
         && (nType & (nScore >= beta ? 2 : 1))) {
-        movesTransposed++;
+        stats.movesTransposed++;
 
         // if the transposition move is quiet, we can update our sorting statistics
         if (nMove.value() != 0 && board.is_legal_move(nMove)) {
@@ -470,8 +511,8 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
     // probe the tablebases
     unsigned tbScore = 0;
-    if ((tbScore = Tablebase::probeTablebaseWDL(board, depth, (ply - rootPly))) != TB_RESULT_FAILED) {
-        ++tbHits;
+    if (tbProbing && (tbScore = Tablebase::probeTablebaseWDL(board, depth, (ply - rootPly), timeTbProbes ? &tbStats : nullptr)) != TB_RESULT_FAILED) {
+        ++stats.tbHits;
 
         // convert WDL to a score
         score = tbScore == TB_LOSS ? -31753 + (ply - rootPly)
@@ -581,7 +622,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
         && board.prevMoveType(ply) != libchess::Move::Type::NONE
         && staticEval >= beta
         && excludedMove.value() == 0
-        && nonPawnMaterial(!board.side_to_move(), board)
+        && board.non_pawn_material(board.side_to_move())
         && (ply - rootPly) >= minNullPly
         && (!board.found() || nScore >= beta)) {
 
@@ -591,10 +632,10 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
         board.continuationHistory() = &continuationHistory[0][0][15][0]; // no piece has a value of 15 so we can use that as our "null" flag
 
-        movesExplored++;
+        stats.movesExplored++;
         board.make_null_move();
         // prefetch after null move
-        prefetch(table.firstEntry(board.hash()));
+        prefetch(table.firstEntry(board.hash() ^ tag));
         incPly();
         int nullScore = -negamax<NonPV>(board, depth - R, -beta, -beta + 1, !cutNode);
         decPly();
@@ -649,7 +690,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
                                                               [board.piece_on(move.from_square())->value()]
                                                               [move.to_square()];
 
-            movesExplored++;
+            stats.movesExplored++;
             board.make_move(move);
 
             // perform a qsearch to verify that the move still is less than beta
@@ -669,7 +710,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
             if (score >= probCutBeta) {
                 // write to the node
                 node->save(hash, tableScore(score, (ply - rootPly)), 2, depth - 3, move.to_table(), board.staticEval(), board.ttPv());
-                cutNodes++;
+                stats.cutNodes++;
                 return score;
             }
 
@@ -691,8 +732,8 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
     // at root, we are going to ignore the picker object.  The amount of time spent allocating and selecting moves should be negligible because this only happens for one position per search
     // here we set the pointer for the current root move to the beginning of the move list, and sort the list
     if constexpr (rootNode) {
-        partial_insertion_sort(rootMoves.begin(), rootMoves.end(), std::numeric_limits<int>::min());
-        currRootMove = rootMoves.begin();
+        std::stable_sort(rootMoves.begin() + pvIdx, rootMoves.end());
+        currRootMove = rootMoves.begin() + pvIdx;
     }
 
     // indicates that a PvNode will probably fail low if the node was searched, and we found a fail low already
@@ -706,8 +747,16 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
     int extension = 0;
     int hist;
+
+    // moves another thread was searching when we got to them, searched once the picker runs out
+    bool deferMoves = abdada && !PvNode && depth >= DEFER_DEPTH && pool.numThreads > 1;
+    libchess::Move deferred[32];
+    int deferredCount = 0;
+    int deferredIdx = 0;
+
     // loop through the possible moves and score each
-    while ((move = picker.nextMove(moveCountPruning)).value() != 0) {
+    while ((move = picker.nextMove(moveCountPruning)).value() != 0
+           || (deferredIdx < deferredCount && (move = deferred[deferredIdx++]).value() != 0)) {
 
         // at root, we do this check just in case the move picker has some illegal moves in it
         if constexpr (rootNode) {
@@ -718,7 +767,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
         // at root, replace the move with the current root move
         if constexpr (rootNode) {
-            move = *currRootMove;
+            move = currRootMove->move;
         }
 
         if (move == excludedMove) {
@@ -731,6 +780,19 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
             continue;
         }
 
+        // the first move is always searched, after that we leave moves another thread is on for later
+        uint64_t deferKey = 0;
+        if (deferMoves) {
+            deferKey = DeferTable::key(board.hash(), move);
+            if (moveCounter > 0 && deferredIdx == 0 && deferredCount < 32 && pool.searching.busy(deferKey)) {
+                deferred[deferredCount++] = move;
+                continue;
+            }
+        }
+
+        // nodes before this root move, so we know how much effort it took
+        uint64_t rootNodesBefore = rootNode ? stats.movesExplored.load() : 0;
+
         // if we are at root, give the gui some information
         if constexpr (rootNode) {
             if (id == 0) {
@@ -754,7 +816,7 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
 
         // quiet move pruning and move count pruning
         if (!rootNode
-            && nonPawnMaterial(!board.side_to_move(), board)
+            && board.non_pawn_material(board.side_to_move())
             && bestScore > -30000) {
 
             // move count pruning
@@ -880,9 +942,13 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
                                                           [move.to_square()];
 
         // prefetch before we make a move
-        prefetch(table.firstEntry(board.hashAfter(move)));
+        prefetch(table.firstEntry(board.hashAfter(move) ^ tag));
+
+        stats.movesExplored++;
 
-        movesExplored++;
+        if (deferMoves) {
+            pool.searching.enter(deferKey);
+        }
 
         // make the move
         board.make_move(move);
@@ -967,14 +1033,28 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
         // undo the move
         board.unmake_move();
 
+        if (deferMoves) {
+            pool.searching.leave(deferKey);
+        }
+
+        if constexpr (rootNode) {
+            currRootMove->nodes += stats.movesExplored.load() - rootNodesBefore;
+        }
+
         // if the search was stopped for whatever reason, return immediately
-        if (gondor.stop || (limits.timeSet && stopTime - startTime <= std::chrono::steady_clock::now() - startTime)) {
+        if (pool.stop) {
             return 0;
         }
 
         // update the move score if at root
+        // moves that fail low keep their (fail soft) bound, it still says something about how they compare
         if constexpr (rootNode) {
             currRootMove->score = score;
+            if (moveCounter == 1 || score > alpha) {
+                currRootMove->selDepth = selDepth;
+                currRootMove->pv.assign(1, move);
+                currRootMove->pv.insert(currRootMove->pv.end(), pvTable[1].begin() + 1, pvTable[1].begin() + pvLength[1]);
+            }
             currRootMove++;
         }
 
@@ -982,8 +1062,11 @@ int Anduril::negamax(libchess::Position &board, int depth, int alpha, int beta,
             bestScore = score;
             if (score > alpha) {
                 bestMove = move;
+                if constexpr (PvNode && !rootNode) {
+                    updatePV(move);
+                }
                 if (score >= beta) {
-                    cutNodes++;
+                    stats.cutNodes++;
                     break;
                 }
                 else {
@@ -1047,7 +1130,9 @@ template int Anduril::negamax<Anduril::Root>(libchess::Position &board, int dept
 void Anduril::bench(libchess::Position &board) {
     // setup for the search
     limits.timeSet = false;
-    movesExplored = 0;
+    stats.clear();
+    tbStats.clear();
+    timeTbProbes = debugMode || syzygyStats;
 
     // set the killer vector to have the correct number of slots
     for (auto i : killers) {
@@ -1073,25 +1158,8 @@ void Anduril::bench(libchess::Position &board) {
     stopTime = std::chrono::steady_clock::now();
     std::chrono::duration<double, std::milli> elapsed = stopTime - startTime;
     std::cout << getMovesExplored() << " nodes " << uint64_t(getMovesExplored() / (elapsed.count() / 1000)) << " nps" << std::endl;
-}
-
-int Anduril::nonPawnMaterial(bool whiteToPlay, libchess::Position &board) {
-    int material = 0;
-    if (whiteToPlay) {
-        material += board.piece_type_bb(libchess::constants::KNIGHT, libchess::constants::WHITE).popcount() * libchess::Position::pieceValuesMG[1];
-        material += board.piece_type_bb(libchess::constants::BISHOP, libchess::constants::WHITE).popcount() * libchess::Position::pieceValuesMG[2];
-        material += board.piece_type_bb(libchess::constants::ROOK, libchess::constants::WHITE).popcount() * libchess::Position::pieceValuesMG[3];
-        material += board.piece_type_bb(libchess::constants::QUEEN, libchess::constants::WHITE).popcount() * libchess::Position::pieceValuesMG[4];
-
-        return material;
-    }
-    else {
-        material += board.piece_type_bb(libchess::constants::KNIGHT, libchess::constants::BLACK).popcount() * libchess::Position::pieceValuesMG[1];
-        material += board.piece_type_bb(libchess::constants::BISHOP, libchess::constants::BLACK).popcount() * libchess::Position::pieceValuesMG[2];
-        material += board.piece_type_bb(libchess::constants::ROOK, libchess::constants::BLACK).popcount() * libchess::Position::pieceValuesMG[3];
-        material += board.piece_type_bb(libchess::constants::QUEEN, libchess::constants::BLACK).popcount() * libchess::Position::pieceValuesMG[4];
-
-        return material;
+    if (tbStats.probes()) {
+        Tablebase::reportStats(tbStats);
     }
 }
 
@@ -1162,74 +1230,31 @@ void Anduril::updateContinuationHistory(libchess::Position &board, libchess::Pie
     }
 }
 
-// finds and returns the principal variation
-std::vector<libchess::Move> Anduril::getPV(libchess::Position &board, int depth, libchess::Move bestMove) {
-    std::vector<libchess::Move> PV;
-    uint64_t hash = 0;
-    Node *node;
-    bool found = true;
-
-    // push the best move and add to the PV
-    PV.push_back(bestMove);
-    board.make_move(bestMove);
-
-    // This loop hashes the board, finds the node associated with the current board
-    // adds the best move we found to the PV, then pushes it to the board
-    hash = board.hash();
-    node = table.probe(hash, found);
-    while (found && node->bestMove != 0) {
-        libchess::Move tmp = board.from_table(node->bestMove);
-        if (board.is_capture_move(tmp) && board.piece_type_on(tmp.to_square()) == std::nullopt && tmp.type() != libchess::Move::Type::ENPASSANT) {
-            break;
-        }
-        // this will make sure we don't segfault
-        // I don't know the problem but this fixed it and the search does not appear to be affected
-        if (board.is_legal_move(tmp)) {
-            PV.push_back(tmp);
-            board.make_move(tmp);
-        }
-        else {
-            break;
-        }
-        hash = board.hash();
-        node = table.probe(hash, found);
-        // in case of infinite loops of repeating moves
-        // also check to see if the pv is still in the main search
-        if (PV.size() > depth || node->nodeDepth <= 0) {
-            break;
-        }
-    }
-
-    // undoes each move in the PV so that we don't have a messed up board
-    for (int i = PV.size() - 1; i >= 0; i--){
-        board.unmake_move();
-    }
-
-    return PV;
-}
-
 uint64_t Anduril::getMovesExplored() {
-    uint64_t total = 0;
-    for (auto &t : gondor) {
-        total += t->engine->movesExplored.load();
-    }
-    return total;
+    return pool.sum(&SearchStats::movesExplored);
 }
 
 uint64_t Anduril::getTbHits() {
-    uint64_t total = 0;
-    for (auto &t : gondor) {
-        total += t->engine->tbHits.load();
-    }
-    return total;
+    return pool.sum(&SearchStats::tbHits);
 }
 
 
-bool Anduril::shouldStop() {
-    if (limits.nodes != -1) {
-        return getMovesExplored() >= limits.nodes;
-    }
+void Anduril::checkTime() {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> sinceLast = now - lastCheck;
 
-    return limits.timeSet && stopTime - startTime <= std::chrono::steady_clock::now() - startTime;
+    // aim to check about once a millisecond at whatever speed we are currently searching
+    double perMs = callsPerCheck / std::max(sinceLast.count(), 0.001);
+    callsPerCheck = std::clamp(int(perMs * POLL_INTERVAL_MS), MIN_POLL_CALLS, MAX_POLL_CALLS);
+    callsUntilCheck = callsPerCheck;
+    lastCheck = now;
 
+    if (limits.timeSet && !pool.pondering && now >= stopTime) {
+        pool.requestStop(stopTime);
+    }
+
+    // held lines go out once the interval is over, the next iteration could take much longer than that
+    if (!heldInfo.empty() && !holdInfo()) {
+        sendHeldInfo(true);
+    }
 }
@@ -15,8 +15,120 @@
 #include "limit.h"
 #include "libchess/Position.h"
 #include "Node.h"
+#include "Output.h"
 #include "TranspositionTable.h"
 #include "PolyglotBook.h"
+#include "Syzygy.h"
+#include "TimeManager.h"
+
+// a counter that only its own thread writes to.  Incrementing is a relaxed load and store instead of a locked add,
+// other threads reading it for info output just see a slightly old value
+class ThreadPool;
+
+class RelaxedCounter {
+public:
+    RelaxedCounter& operator++() {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return *this;
+    }
+    void operator++(int) { ++*this; }
+
+    RelaxedCounter& operator=(uint64_t v) {
+        value.store(v, std::memory_order_relaxed);
+        return *this;
+    }
+
+    uint64_t load() const { return value.load(std::memory_order_relaxed); }
+    operator uint64_t() const { return load(); }
+
+private:
+    std::atomic<uint64_t> value = 0;
+};
+
+// the counters for a single search thread
+// aligned to its own cache line so the threads never invalidate each other's counters
+struct alignas(64) SearchStats {
+    // total number of moves searched
+    RelaxedCounter movesExplored;
+
+    // total number of tb hits
+    RelaxedCounter tbHits;
+
+    // total amount of cut nodes
+    RelaxedCounter cutNodes;
+
+    // amount of moves we hashed from the transpo table
+    RelaxedCounter movesTransposed;
+
+    // amount of moves we searched in quiescence
+    RelaxedCounter quiesceExplored;
+
+    void clear() {
+        movesExplored = 0;
+        tbHits = 0;
+        cutNodes = 0;
+        movesTransposed = 0;
+        quiesceExplored = 0;
+    }
+};
+
+// a move at the root and what the search found for it
+struct RootMove {
+    explicit RootMove(libchess::Move move) : move(move) {}
+
+    // sorts the best scores to the front, ties are broken by how the moves did in the last depth
+    bool operator<(const RootMove &rhs) const {
+        return score != rhs.score ? score > rhs.score : previousScore > rhs.previousScore;
+    }
+
+    libchess::Move move;
+
+    // score from the current and the last depth
+    int score = 0;
+    int previousScore = -32001;
+
+    // selective depth and principal variation from the last time this move raised alpha
+    int selDepth = 0;
+    std::vector<libchess::Move> pv;
+
+    // nodes spent below this move this search
+    uint64_t nodes = 0;
+
+    // how good the tablebases say this move is, higher is better.  Only set when the root is in the tablebases
+    int tbRank = 0;
+};
+
+// the last iteration a thread finished, the threads vote on the final move with these
+struct SearchResult {
+    int depth = 0;
+    int score = -32001;
+    int selDepth = 0;
+    std::vector<libchess::Move> pv;
+};
+
+// an info line in numbers instead of text, for programs that run the engine in their own process
+struct SearchReport {
+    // the multipv line, starting at 0
+    int line = 0;
+
+    // centipawns, or moves until mate (negative when we get mated) if mate is set
+    int score = 0;
+    bool mate = false;
+    bool upperBound = false;
+    bool lowerBound = false;
+
+    int depth = 0;
+    int selDepth = 0;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    uint64_t tbHits = 0;
+    int hashFull = 0;
+
+    // milliseconds since the search started
+    uint64_t time = 0;
+
+    std::vector<libchess::Move> pv;
+};
 
 class Anduril {
 public:
@@ -35,7 +147,7 @@ public:
               ALL_PIECES
             };
 
-    Anduril(int id) : id(id) { resetHistories(); }
+    Anduril(int id, ThreadPool &pool) : id(id), pool(pool) { resetHistories(); }
 
     // calls negamax and keeps track of the best move
     // this version will also interact with UCI
@@ -53,18 +165,12 @@ public:
     // generates a static evaluation of the board
     int evaluateBoard(libchess::Position &board);
 
-    // getter and setter for moves explored
+    // moves explored and tb hits summed over every thread
     uint64_t getMovesExplored();
-
-    inline void setMovesExplored(int moves) { movesExplored = moves; }
-
-    // getter and setter for tb hits
     uint64_t getTbHits();
 
-    void setTbHits(int hits) { tbHits = hits; }
-
-    // checks if the search should stop due to time (or node) limit
-    bool shouldStop();
+    // checks the clock, then decides how many nodes to wait before checking again
+    void checkTime();
 
     // benchmarks the engine
     void bench(libchess::Position &board);
@@ -79,9 +185,6 @@ public:
     inline void incPly() { ply++; }
     inline void decPly() { ply--; }
 
-    // finds and returns the principal variation
-    std::vector<libchess::Move> getPV(libchess::Position &board, int depth, libchess::Move bestMove);
-
     // reset the move and counter move tables
     inline void resetHistories() {
         for (int i = 0; i < 64; i++) {
@@ -128,6 +231,9 @@ public:
     // time we should stop the search
     std::chrono::time_point<std::chrono::steady_clock> stopTime;
 
+    // soft and hard limits for searches on the clock
+    TimeManager timeManager;
+
     // endgame values used for qsearch
     static int pieceValues[16];
 
@@ -141,11 +247,19 @@ public:
 
     const int id;
 
-    // total number of moves Anduril searched
-    std::atomic<uint64_t> movesExplored;
+    // the pool this thread belongs to, the search takes its stop flag, node budget and callbacks from here
+    ThreadPool &pool;
 
-    // total number of tb hits
-    std::atomic<uint64_t> tbHits;
+    // node counts and other statistics for this thread
+    SearchStats stats;
+
+    // latencies of this thread's tablebase probes, only read once the search is over.  They are only collected
+    // in debug mode or with SyzygyStats on
+    Tablebase::ProbeStats tbStats;
+    bool timeTbProbes = false;
+
+    // what this thread found in its deepest finished iteration, empty until it finishes one
+    SearchResult result;
 
 private:
 
@@ -164,20 +278,64 @@ private:
     // selective depth
     int selDepth = 0;
 
+    // nodes left before the main thread checks the clock again, and how many there were when we last checked
+    int callsUntilCheck = 0;
+    int callsPerCheck = 0;
+
+    // when the clock was last checked
+    std::chrono::time_point<std::chrono::steady_clock> lastCheck;
+
+    // false when the root moves were already ranked by the tablebases and probing during the search wouldn't help
+    bool tbProbing = true;
+
+    // true when the root moves were ranked by the tablebases
+    bool rootInTB = false;
+
+    // the pool's hash tag, mixed into every key we look up in the transposition table
+    uint64_t tag = 0;
+
+    // true when searching under a node limit, the thread has to take its nodes from the pool's budget
+    bool nodeLimited = false;
+
+    // node count at which this thread has used up the nodes it took from the budget
+    uint64_t quantumEnd = 0;
+
     uint64_t singularAttempts = 0;
     uint64_t singularExtensions = 0;
 
     // list of moves at root position
-    libchess::MoveList rootMoves;
-    libchess::Move *currRootMove;
+    std::vector<RootMove> rootMoves;
+    std::vector<RootMove>::iterator currRootMove;
+
+    // the multipv line we are searching, the root moves before it are skipped
+    int pvIdx = 0;
+
+    // the depth of the next iteration, helper threads skip some depths according to their schedule
+    int nextDepth(int depth) const;
+
+    // fills rootMoves with the moves to search and ranks them with the tablebases if the root is in them.
+    // only the main thread calls this, the helpers are handed a copy
+    void findRootMoves(libchess::Position &board);
+
+    // sends one line of search info to the GUI, line is the multipv index starting at 0.
+    // held lines are kept in heldInfo instead, to be sent before bestmove if nothing newer went out.
+    // if the pool has an info callback every line goes to it instead, held or not
+    void sendInfo(int line, int score, int depth, int seldepth, bool upper, bool lower, const std::vector<libchess::Move> &pv, bool hold);
+
+    // true if the last info went out so recently that the next one should be held back
+    bool holdInfo() const;
+
+    // sends the lines that were held back
+    void sendHeldInfo(bool droppable);
+
+    // when the last info line went out, and the newest lines that were held back since then
+    std::chrono::time_point<std::chrono::steady_clock> lastInfo;
+    std::vector<Output::Line> heldInfo;
 
     // this version actually performs the perft search
     template<bool root>
     uint64_t perft(libchess::Position &board, int depth);
 
-    // returns the amount of non pawn material (excluding kings)
-    int nonPawnMaterial(bool whiteToPlay, libchess::Position &board);
-
     // insert a move to the killer list
     inline void insertKiller(libchess::Move move, int depth) {
         if (killers[depth][0] != move) {
@@ -242,6 +400,25 @@ private:
     // oversize array just to be sure we dont seg fault
     KillerMoves killers;
 
+    // triangular principal variation table, indexed by distance from root
+    // row n holds the best line from ply n onward and is pvLength[n] - n moves long
+    static constexpr int MAX_PV = 128;
+    std::array<std::array<libchess::Move, MAX_PV>, MAX_PV> pvTable;
+    std::array<int, MAX_PV> pvLength;
+
+    // starts an empty line at the current ply, called on entering a PV node
+    inline void clearPV() { pvLength[ply - rootPly] = ply - rootPly; }
+
+    // a PV node raised alpha with move, so its line becomes move followed by the child's line
+    inline void updatePV(libchess::Move move) {
+        int sply = ply - rootPly;
+        pvTable[sply][sply] = move;
+        for (int i = sply + 1; i < pvLength[sply + 1]; i++) {
+            pvTable[sply][i] = pvTable[sply + 1][i];
+        }
+        pvLength[sply] = std::max(pvLength[sply + 1], sply + 1);
+    }
+
     // counter moves
     CounterMoves counterMoves;
 
@@ -274,15 +451,6 @@ private:
 
 };
 
-// total amount of cut nodes
-static std::atomic<uint64_t> cutNodes;
-
-// amount of moves we hashed from the transpo table
-static std::atomic<uint64_t> movesTransposed;
-
-// amount of moves we searched in quiescence
-static std::atomic<uint64_t> quiesceExplored;
-
 // initialize the reduction table
 void initReductions(double nem, double neb, double tem, double teb);
 
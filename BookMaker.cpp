@@ -0,0 +1,566 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <thread>
+
+#include "BookMaker.h"
+#include "misc.h"
+
+namespace {
+    const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // games are handed to the parsers in batches to keep the queue locking down
+    constexpr size_t BATCH_SIZE = 256;
+
+    // the position only has room for so many states, nobody needs a book this deep anyways
+    constexpr int MAX_PLY = 512;
+
+    // how many records a parser collects before adding them to the shards
+    constexpr size_t FLUSH_SIZE = 1 << 16;
+
+    // polyglot entries are stored big endian
+    void writeBigEndian(std::ofstream &out, uint64_t value, int bytes) {
+        char buffer[8];
+        for (int i = 0; i < bytes; i++) {
+            buffer[i] = char(value >> (8 * (bytes - 1 - i)));
+        }
+        out.write(buffer, bytes);
+    }
+
+    // returns 1 for white winning, -1 for black winning, and 0 for a draw or a game without a result
+    int parseResult(const std::string &result) {
+        if (result == "1-0") {
+            return 1;
+        }
+        if (result == "0-1") {
+            return -1;
+        }
+        return 0;
+    }
+
+    bool isResult(const std::string &token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    // reads the records of a run file back in order
+    class RunReader {
+    public:
+        explicit RunReader(const std::string &file) : in(file, std::ios::binary) {}
+
+        template<class T>
+        bool next(T &record) {
+            return bool(in.read(reinterpret_cast<char*>(&record), sizeof(T)));
+        }
+
+    private:
+        std::ifstream in;
+    };
+}
+
+BookMaker::BookMaker(int threads, int maxPly, int minGames, size_t memoryMB) : threads(std::max(threads, 1)),
+                                                                                maxPly(std::clamp(maxPly, 1, MAX_PLY)),
+                                                                                minGames(std::max(minGames, 1)),
+                                                                                memoryBytes(std::max<size_t>(memoryMB, 16) * 1024 * 1024),
+                                                                                shards(SHARDS) {}
+
+uint16_t BookMaker::toPolyglot(libchess::Move move, libchess::Position &board) {
+    int from = move.from_square().value();
+    int to = move.to_square().value();
+
+    // polyglot wants castling as the king moving onto the rook
+    if (board.piece_type_on(move.from_square()) == libchess::constants::KING && std::abs((from & 7) - (to & 7)) == 2) {
+        to = (from & ~7) | ((to & 7) > (from & 7) ? 7 : 0);
+    }
+
+    uint16_t promotion = 0;
+    if (auto pt = move.promotion_piece_type()) {
+        // knight = 1, bishop = 2, rook = 3, queen = 4
+        promotion = uint16_t(pt->value());
+    }
+
+    return uint16_t((to & 7) | ((to >> 3) << 3) | ((from & 7) << 6) | ((from >> 3) << 9) | (promotion << 12));
+}
+
+libchess::Move BookMaker::fromSAN(const std::string &token, libchess::Position &board) {
+    // strip check marks and annotations
+    std::string san = token;
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.pop_back();
+    }
+    if (san.size() < 2) {
+        return libchess::Move(0);
+    }
+
+    libchess::Color stm = board.side_to_move();
+    libchess::PieceType pt = libchess::constants::PAWN;
+    std::optional<libchess::PieceType> promotion;
+    std::optional<libchess::File> fromFile;
+    std::optional<libchess::Rank> fromRank;
+    libchess::Square to = libchess::constants::A1;
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        pt = libchess::constants::KING;
+        libchess::Square king = board.king_square(stm);
+        to = *libchess::Square::from(san.size() == 3 ? libchess::constants::FILE_G : libchess::constants::FILE_C, king.rank());
+        fromFile = king.file();
+    }
+    else {
+        if (std::string("NBRQK").find(san[0]) != std::string::npos) {
+            pt = *libchess::PieceType::from(san[0]);
+            san.erase(0, 1);
+        }
+
+        // promotions can come with or without the '='
+        if (pt == libchess::constants::PAWN && std::string("NBRQ").find(san.back()) != std::string::npos) {
+            promotion = libchess::PieceType::from(san.back());
+            san.pop_back();
+            if (!san.empty() && san.back() == '=') {
+                san.pop_back();
+            }
+        }
+
+        san.erase(std::remove(san.begin(), san.end(), 'x'), san.end());
+        if (san.size() < 2) {
+            return libchess::Move(0);
+        }
+
+        auto square = libchess::Square::from(san.substr(san.size() - 2));
+        if (!square) {
+            return libchess::Move(0);
+        }
+        to = *square;
+
+        // whatever is left before the destination disambiguates the piece
+        for (size_t i = 0; i + 2 < san.size(); i++) {
+            if (san[i] >= 'a' && san[i] <= 'h') {
+                fromFile = libchess::File::from(san[i]);
+            }
+            else if (san[i] >= '1' && san[i] <= '8') {
+                fromRank = libchess::Rank::from(san[i]);
+            }
+        }
+    }
+
+    libchess::MoveList moves = board.legal_move_list();
+    for (libchess::Move move : moves) {
+        libchess::Square from = move.from_square();
+        if (move.to_square() != to || board.piece_type_on(from) != pt || move.promotion_piece_type() != promotion
+            || (fromFile && from.file() != *fromFile) || (fromRank && from.rank() != *fromRank)) {
+            continue;
+        }
+        return move;
+    }
+
+    return libchess::Move(0);
+}
+
+bool BookMaker::make(const std::string &input, const std::string &output) {
+    std::ifstream in(input);
+    if (!in) {
+        std::cout << "info string makebook could not open " << input << std::endl;
+        return false;
+    }
+
+    runPrefix = output + ".run";
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> parsers;
+    for (int i = 0; i < threads; i++) {
+        parsers.emplace_back(&BookMaker::worker, this);
+    }
+
+    // hands a batch to the parsers, waiting if they are too far behind
+    auto push = [this](std::vector<std::string> &batch) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueCV.wait(lock, [&] { return queue.size() < size_t(2 * threads); });
+        queue.push_back(std::move(batch));
+        batch.clear();
+        lock.unlock();
+        queueCV.notify_all();
+    };
+
+    // PGN files start with tags, anything else is treated as one game of UCI moves per line
+    std::string line, game;
+    std::vector<std::string> batch;
+    bool firstLine = true, inMoves = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (firstLine && !line.empty()) {
+            pgn = line[0] == '[';
+            firstLine = false;
+        }
+
+        if (!pgn) {
+            if (!line.empty()) {
+                batch.push_back(line);
+            }
+        }
+        else {
+            // a tag after we've seen moves means the last game is finished
+            if (!line.empty() && line[0] == '[' && inMoves) {
+                batch.push_back(std::move(game));
+                game.clear();
+                inMoves = false;
+            }
+            else if (!line.empty() && line[0] != '[') {
+                inMoves = true;
+            }
+            game += line;
+            game += '\n';
+        }
+
+        if (batch.size() >= BATCH_SIZE) {
+            push(batch);
+        }
+    }
+    if (!game.empty()) {
+        batch.push_back(std::move(game));
+    }
+    if (!batch.empty()) {
+        push(batch);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        done = true;
+    }
+    queueCV.notify_all();
+
+    for (auto &t : parsers) {
+        t.join();
+    }
+
+    std::chrono::duration<double> parseTime = std::chrono::steady_clock::now() - start;
+    bool written = !failed && writeBook(output);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "info string makebook parsed " << games << " games (" << badGames << " stopped early on a bad move) and "
+              << positions << " positions in " << parseTime.count() << "s, "
+              << uint64_t(games / std::max(parseTime.count(), 1e-9)) << " games/sec" << std::endl;
+    std::cout << "info string makebook " << (written ? "wrote " + output : "failed to write " + output)
+              << " in " << elapsed.count() << "s using " << runCount << " spilled runs, peak RSS "
+              << peakMemoryUsage() / (1024 * 1024) << " MB" << std::endl;
+
+    return written;
+}
+
+void BookMaker::worker() {
+    libchess::Position board(StartFEN);
+    std::vector<Record> records;
+    records.reserve(FLUSH_SIZE + 2 * size_t(maxPly));
+
+    while (true) {
+        std::vector<std::string> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCV.wait(lock, [&] { return !queue.empty() || done; });
+            if (queue.empty()) {
+                break;
+            }
+            batch = std::move(queue.back());
+            queue.pop_back();
+        }
+        queueCV.notify_all();
+
+        for (const std::string &game : batch) {
+            parseGame(game, board, records);
+            if (records.size() >= FLUSH_SIZE) {
+                flush(records);
+            }
+        }
+    }
+
+    flush(records);
+}
+
+void BookMaker::parseGame(const std::string &game, libchess::Position &board, std::vector<Record> &records) {
+    std::string fen = StartFEN, result, moveText;
+
+    if (pgn) {
+        // split the tags from the moves
+        std::istringstream lines(game);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (!line.empty() && line[0] == '[') {
+                size_t quote = line.find('"'), endQuote = line.rfind('"');
+                if (quote == std::string::npos || endQuote <= quote) {
+                    continue;
+                }
+                std::string value = line.substr(quote + 1, endQuote - quote - 1);
+                if (line.compare(0, 5, "[FEN ") == 0) {
+                    fen = value;
+                }
+                else if (line.compare(0, 8, "[Result ") == 0) {
+                    result = value;
+                }
+            }
+            else {
+                // rest of line comments are dropped here since we lose the line breaks after this
+                moveText += line.substr(0, line.find(';'));
+                moveText += ' ';
+            }
+        }
+    }
+    else {
+        moveText = game;
+    }
+
+    if (fen != board.start_fen()) {
+        auto pos = libchess::Position::from_fen(fen);
+        if (!pos) {
+            badGames++;
+            return;
+        }
+        board = *pos;
+    }
+    const int rootPly = board.ply();
+
+    // first pass pulls out the move tokens so we know the result before weighing any moves
+    std::vector<std::string> tokens;
+    std::string token;
+    int depth = 0;
+    bool comment = false;
+    for (size_t i = 0; i <= moveText.size(); i++) {
+        char c = i < moveText.size() ? moveText[i] : ' ';
+
+        // comments run until the closing brace no matter what is in them, variations can be nested
+        if (comment) {
+            comment = c != '}';
+            continue;
+        }
+        if (c == '{') {
+            comment = true;
+            continue;
+        }
+        if (c == '(' || (c == ')' && depth > 0)) {
+            depth += c == '(' ? 1 : -1;
+            continue;
+        }
+        if (depth > 0) {
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\n') {
+            if (!token.empty()) {
+                // move numbers can be stuck to the move that follows them
+                size_t dot = token.find_last_of('.');
+                if (dot != std::string::npos) {
+                    token.erase(0, dot + 1);
+                }
+                if (isResult(token)) {
+                    result = token;
+                }
+                else if (!token.empty() && token[0] != '$') {
+                    tokens.push_back(token);
+                }
+                token.clear();
+            }
+            continue;
+        }
+        token += c;
+    }
+
+    // wins are worth 2, draws 1, and losses nothing to the side that played the move
+    int outcome = parseResult(result);
+
+    for (const std::string &moveToken : tokens) {
+        if (board.ply() - rootPly >= maxPly) {
+            break;
+        }
+
+        libchess::Move move(0);
+        if (pgn) {
+            move = fromSAN(moveToken, board);
+        }
+        else if (auto uci = libchess::Move::from(moveToken)) {
+            // UCI moves don't know their type, so we grab the matching generated move to make sure it is legal
+            libchess::MoveList moves = board.legal_move_list();
+            for (libchess::Move legal : moves) {
+                if (legal.from_square() == uci->from_square() && legal.to_square() == uci->to_square()
+                    && legal.promotion_piece_type() == uci->promotion_piece_type()) {
+                    move = legal;
+                    break;
+                }
+            }
+        }
+
+        if (move.value() == 0) {
+            badGames++;
+            break;
+        }
+
+        int sign = board.side_to_move() == libchess::constants::WHITE ? 1 : -1;
+        records.push_back(Record{board.hash(), toPolyglot(move, board), uint32_t(1 + sign * outcome), 1});
+        positions++;
+        board.make_move(move);
+    }
+
+    while (board.ply() > rootPly) {
+        board.unmake_move();
+    }
+    games++;
+}
+
+void BookMaker::flush(std::vector<Record> &records) {
+    // group the records by shard so each lock is only taken once
+    std::sort(records.begin(), records.end(), [](const Record &a, const Record &b) { return a.key < b.key; });
+
+    size_t i = 0;
+    while (i < records.size()) {
+        int index = shardOf(records[i].key);
+        Shard &shard = shards[index];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (; i < records.size() && shardOf(records[i].key) == index; i++) {
+            Counts &counts = shard.entries[EntryKey{records[i].key, records[i].move}];
+            counts.weight += records[i].weight;
+            counts.count += records[i].count;
+        }
+
+        if (shard.entries.size() * BYTES_PER_ENTRY > memoryBytes / SHARDS) {
+            spill(shard, index);
+        }
+    }
+
+    records.clear();
+}
+
+void BookMaker::spill(Shard &shard, int index) {
+    std::vector<Record> sorted;
+    sorted.reserve(shard.entries.size());
+    for (const auto &[entry, counts] : shard.entries) {
+        sorted.push_back(Record{entry.key, entry.move, counts.weight, counts.count});
+    }
+    // swapping with an empty map is the only way to actually give the memory back
+    std::unordered_map<EntryKey, Counts, EntryHash>().swap(shard.entries);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string file = runPrefix + std::to_string(index) + "." + std::to_string(shard.runs.size());
+    std::ofstream out(file, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(sorted.data()), std::streamsize(sorted.size() * sizeof(Record)));
+    if (!out) {
+        std::cout << "info string makebook failed to write " << file << std::endl;
+        failed = true;
+    }
+
+    shard.runs.push_back(file);
+    runCount++;
+}
+
+bool BookMaker::writeBook(const std::string &output) {
+    std::ofstream out(output, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+
+    // the moves of the position currently being collected
+    uint64_t currentKey = 0;
+    std::vector<Record> moves;
+
+    auto writePosition = [&]() {
+        // positions that are too rare or only ever lost don't belong in the book
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const Record &r) {
+            return r.count < uint32_t(minGames) || r.weight == 0;
+        }), moves.end());
+        if (moves.empty()) {
+            return;
+        }
+
+        std::sort(moves.begin(), moves.end(), [](const Record &a, const Record &b) { return a.weight > b.weight; });
+
+        // polyglot weights are only 16 bits, so scale everything down by the most popular move if needed
+        uint64_t maxWeight = moves.front().weight;
+        for (const Record &r : moves) {
+            uint64_t weight = maxWeight > 0xFFFF ? std::max<uint64_t>(1, r.weight * 0xFFFFULL / maxWeight) : r.weight;
+            writeBigEndian(out, r.key, 8);
+            writeBigEndian(out, r.move, 2);
+            writeBigEndian(out, weight, 2);
+            writeBigEndian(out, 0, 4);
+        }
+        moves.clear();
+    };
+
+    auto add = [&](const Record &r) {
+        if (!moves.empty() && r.key != currentKey) {
+            writePosition();
+        }
+        currentKey = r.key;
+
+        // runs can share (key, move) pairs, they are next to each other after the merge
+        if (!moves.empty() && moves.back().move == r.move) {
+            moves.back().weight += r.weight;
+            moves.back().count += r.count;
+        }
+        else {
+            moves.push_back(r);
+        }
+    };
+
+    for (int index = 0; index < SHARDS; index++) {
+        Shard &shard = shards[index];
+
+        // what is still in memory gets sorted and merged with the runs as if it were one more
+        std::vector<Record> memory;
+        memory.reserve(shard.entries.size());
+        for (const auto &[entry, counts] : shard.entries) {
+            memory.push_back(Record{entry.key, entry.move, counts.weight, counts.count});
+        }
+        std::unordered_map<EntryKey, Counts, EntryHash>().swap(shard.entries);
+        std::sort(memory.begin(), memory.end());
+
+        // k-way merge over the runs, the source index of -1 is the in memory records
+        std::vector<std::unique_ptr<RunReader>> readers;
+        using Item = std::pair<Record, int>;
+        auto greater = [](const Item &a, const Item &b) { return b.first < a.first; };
+        std::priority_queue<Item, std::vector<Item>, decltype(greater)> heap(greater);
+
+        size_t memoryIndex = 0;
+        if (memoryIndex < memory.size()) {
+            heap.push({memory[memoryIndex++], -1});
+        }
+        for (const std::string &file : shard.runs) {
+            readers.push_back(std::make_unique<RunReader>(file));
+            Record r{};
+            if (readers.back()->next(r)) {
+                heap.push({r, int(readers.size()) - 1});
+            }
+        }
+
+        while (!heap.empty()) {
+            auto [record, source] = heap.top();
+            heap.pop();
+            add(record);
+
+            Record r{};
+            if (source < 0) {
+                if (memoryIndex < memory.size()) {
+                    heap.push({memory[memoryIndex++], -1});
+                }
+            }
+            else if (readers[source]->next(r)) {
+                heap.push({r, source});
+            }
+        }
+
+        readers.clear();
+        for (const std::string &file : shard.runs) {
+            std::error_code ec;
+            std::filesystem::remove(file, ec);
+        }
+        shard.runs.clear();
+    }
+    writePosition();
+
+    return bool(out);
+}
@@ -0,0 +1,113 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_BOOKMAKER_H
+#define ANDURIL_ENGINE_BOOKMAKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "libchess/Position.h"
+
+// builds a polyglot book from a collection of games, either PGN or one game of UCI moves per line.
+// the input is streamed to a pool of parsing threads, the (key, move) weights are collected in sharded hash maps,
+// and shards that grow past the memory budget are spilled to sorted run files that get merged into the book at the end
+class BookMaker {
+public:
+    BookMaker(int threads, int maxPly, int minGames, size_t memoryMB);
+
+    // builds the book, returns false if the input couldn't be read or the book couldn't be written
+    bool make(const std::string &input, const std::string &output);
+
+    // converts a move to the polyglot encoding, castling is stored as the king capturing its own rook
+    static uint16_t toPolyglot(libchess::Move move, libchess::Position &board);
+
+    // finds the legal move matching a SAN string, returns Move(0) if there isn't one
+    static libchess::Move fromSAN(const std::string &san, libchess::Position &board);
+
+private:
+
+    // a single (key, move) pair and the results it has collected
+    struct Record {
+        uint64_t key;
+        uint16_t move;
+        uint32_t weight;
+        uint32_t count;
+
+        bool operator<(const Record &rhs) const { return key < rhs.key || (key == rhs.key && move < rhs.move); }
+    };
+
+    struct EntryKey {
+        uint64_t key;
+        uint16_t move;
+
+        bool operator==(const EntryKey &rhs) const { return key == rhs.key && move == rhs.move; }
+    };
+
+    struct EntryHash {
+        size_t operator()(const EntryKey &e) const { return size_t(e.key ^ (uint64_t(e.move) * 0x9E3779B97F4A7C15ULL)); }
+    };
+
+    struct Counts {
+        uint32_t weight = 0;
+        uint32_t count = 0;
+    };
+
+    // the keys of a shard all share their top bits, so the shards can be written out one after another in key order
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<EntryKey, Counts, EntryHash> entries;
+        std::vector<std::string> runs;
+    };
+
+    static constexpr int SHARD_BITS = 6;
+    static constexpr int SHARDS = 1 << SHARD_BITS;
+
+    // rough cost of a single entry in the hash maps, used to keep us under the memory budget
+    static constexpr size_t BYTES_PER_ENTRY = 64;
+
+    static int shardOf(uint64_t key) { return int(key >> (64 - SHARD_BITS)); }
+
+    void worker();
+
+    // parses a single game and adds every position up to the ply limit to the records
+    void parseGame(const std::string &game, libchess::Position &board, std::vector<Record> &records);
+
+    // adds a batch of records to the shards, spilling any shard that grew past its share of the budget
+    void flush(std::vector<Record> &records);
+
+    // sorts the shard and writes it out to a new run file, shard mutex must be held
+    void spill(Shard &shard, int index);
+
+    // merges the runs and what is left in memory for every shard, writing the book in key order
+    bool writeBook(const std::string &output);
+
+    int threads;
+    int maxPly;
+    int minGames;
+    size_t memoryBytes;
+    bool pgn = false;
+    std::string runPrefix;
+
+    std::vector<Shard> shards;
+
+    // the queue of game batches between the reader and the parsers, bounded to keep memory in check
+    std::mutex queueMutex;
+    std::condition_variable queueCV;
+    std::vector<std::vector<std::string>> queue;
+    bool done = false;
+
+    std::atomic<uint64_t> games = 0;
+    std::atomic<uint64_t> positions = 0;
+    std::atomic<uint64_t> badGames = 0;
+    std::atomic<uint64_t> runCount = 0;
+    std::atomic<bool> failed = false;
+};
+
+#endif //ANDURIL_ENGINE_BOOKMAKER_H
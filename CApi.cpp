@@ -0,0 +1,131 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include "CApi.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+
+struct anduril_engine {
+    Engine engine;
+};
+
+namespace {
+    std::atomic<bool> created = false;
+
+    anduril_move toC(libchess::Move move) {
+        anduril_move out{};
+        if (move.value() != 0) {
+            *move.write(out.uci) = '\0';
+        }
+        return out;
+    }
+}
+
+anduril_engine *anduril_create(void) {
+    if (created.exchange(true)) {
+        return nullptr;
+    }
+    return new anduril_engine();
+}
+
+void anduril_destroy(anduril_engine *engine) {
+    if (engine) {
+        delete engine;
+        created = false;
+    }
+}
+
+void anduril_limits_init(anduril_limits *limits) {
+    limits->wtime = -1;
+    limits->btime = -1;
+    limits->winc = 0;
+    limits->binc = 0;
+    limits->movestogo = -1;
+    limits->movetime = -1;
+    limits->depth = -1;
+    limits->nodes = -1;
+    limits->infinite = 0;
+}
+
+int anduril_set_position(anduril_engine *engine, const char *fen, const char *const *moves, size_t count) {
+    if (!fen) {
+        return 0;
+    }
+    return engine->engine.setPosition(fen, std::vector<std::string>(moves, moves + count));
+}
+
+void anduril_set_option(anduril_engine *engine, const char *name, const char *value) {
+    engine->engine.setOption(name, value ? value : "");
+}
+
+void anduril_new_game(anduril_engine *engine) {
+    engine->engine.newGame();
+}
+
+void anduril_search(anduril_engine *engine, const anduril_limits *limits, anduril_info_callback on_info,
+                    anduril_bestmove_callback on_bestmove, void *user) {
+    Engine::Limits search;
+    if (limits) {
+        search.whiteTime = limits->wtime;
+        search.blackTime = limits->btime;
+        search.whiteIncrement = limits->winc;
+        search.blackIncrement = limits->binc;
+        search.movesToGo = limits->movestogo;
+        search.moveTime = limits->movetime;
+        search.depth = limits->depth;
+        search.nodes = limits->nodes;
+        search.infinite = limits->infinite != 0;
+    }
+
+    // without a callback the search would print, so a missing one just throws the results away
+    Engine::InfoCallback info = [on_info, user](const SearchReport &report) {
+        if (!on_info) {
+            return;
+        }
+
+        // only the search thread gets here, so it can reuse one buffer for every line
+        thread_local std::vector<anduril_move> pv;
+        pv.clear();
+        for (libchess::Move move : report.pv) {
+            pv.push_back(toC(move));
+        }
+
+        anduril_info out{};
+        out.line = report.line;
+        out.score = report.score;
+        out.mate = report.mate;
+        out.upperbound = report.upperBound;
+        out.lowerbound = report.lowerBound;
+        out.depth = report.depth;
+        out.seldepth = report.selDepth;
+        out.nodes = report.nodes;
+        out.nps = report.nps;
+        out.tbhits = report.tbHits;
+        out.hashfull = report.hashFull;
+        out.time = report.time;
+        out.pv = pv.data();
+        out.pv_length = pv.size();
+        on_info(&out, user);
+    };
+
+    Engine::BestMoveCallback bestMove = [on_bestmove, user](libchess::Move best, libchess::Move ponder) {
+        if (on_bestmove) {
+            on_bestmove(toC(best).uci, toC(ponder).uci, user);
+        }
+    };
+
+    engine->engine.search(search, info, bestMove);
+}
+
+void anduril_stop(anduril_engine *engine) {
+    engine->engine.stop();
+}
+
+void anduril_wait(anduril_engine *engine) {
+    engine->engine.wait();
+}
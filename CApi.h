@@ -0,0 +1,81 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_CAPI_H
+#define ANDURIL_ENGINE_CAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// a C interface over Engine, for programs that can't use the C++ class directly.
+// the engine's state is global, so only one engine can exist at a time
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct anduril_engine anduril_engine;
+
+// times are in milliseconds, -1 when not given.  Call anduril_limits_init to get the defaults
+typedef struct {
+    int wtime;
+    int btime;
+    int winc;
+    int binc;
+    int movestogo;
+    int movetime;
+    int depth;
+    int64_t nodes;
+    int infinite;
+} anduril_limits;
+
+// a move in UCI notation, such as e2e4 or e7e8q
+typedef struct {
+    char uci[6];
+} anduril_move;
+
+// one info line, the pv is only valid until the callback returns
+typedef struct {
+    int line;
+    int score;
+    int mate;
+    int upperbound;
+    int lowerbound;
+    int depth;
+    int seldepth;
+    uint64_t nodes;
+    uint64_t nps;
+    uint64_t tbhits;
+    int hashfull;
+    uint64_t time;
+    const anduril_move *pv;
+    size_t pv_length;
+} anduril_info;
+
+// called on the search thread, or for a book move on the thread calling anduril_search before it returns.
+// ponder is an empty string when there is no move to ponder on
+typedef void (*anduril_info_callback)(const anduril_info *info, void *user);
+typedef void (*anduril_bestmove_callback)(const char *best, const char *ponder, void *user);
+
+// returns NULL if an engine already exists
+anduril_engine *anduril_create(void);
+void anduril_destroy(anduril_engine *engine);
+
+void anduril_limits_init(anduril_limits *limits);
+
+// fen may be "startpos".  Returns 0 and keeps the old position if the fen or one of the moves is bad
+int anduril_set_position(anduril_engine *engine, const char *fen, const char *const *moves, size_t count);
+void anduril_set_option(anduril_engine *engine, const char *name, const char *value);
+void anduril_new_game(anduril_engine *engine);
+
+// starts a search and returns right away, either callback may be NULL
+void anduril_search(anduril_engine *engine, const anduril_limits *limits, anduril_info_callback on_info,
+                    anduril_bestmove_callback on_bestmove, void *user);
+void anduril_stop(anduril_engine *engine);
+void anduril_wait(anduril_engine *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ANDURIL_ENGINE_CAPI_H
@@ -0,0 +1,43 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_DEFERTABLE_H
+#define ANDURIL_ENGINE_DEFERTABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "libchess/Move.h"
+
+// idea from ABDADA: a small lossy table of the (position, move) pairs the threads are searching right now.
+// a thread that finds its move in here puts it off until the end of the move loop, and by then the other thread
+// has usually stored the result in the transposition table.  Collisions only cost a deferral or a missed one
+class DeferTable {
+public:
+    // the key for a move from a position, never 0 so that an empty slot can't match
+    static uint64_t key(uint64_t hash, libchess::Move move) {
+        return (hash ^ ((uint64_t(move.value()) + 1) * 0x9E3779B97F4A7C15ULL)) | 1;
+    }
+
+    bool busy(uint64_t key) const { return slot(key).load(std::memory_order_relaxed) == key; }
+
+    void enter(uint64_t key) { slot(key).store(key, std::memory_order_relaxed); }
+
+    // only clears the slot if nobody has taken it over since we entered
+    void leave(uint64_t key) {
+        uint64_t expected = key;
+        slot(key).compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int SIZE = 1 << 15;
+
+    std::atomic<uint64_t> &slot(uint64_t key) { return table[key >> 49]; }
+    const std::atomic<uint64_t> &slot(uint64_t key) const { return table[key >> 49]; }
+
+    std::array<std::atomic<uint64_t>, SIZE> table{};
+};
+
+#endif //ANDURIL_ENGINE_DEFERTABLE_H
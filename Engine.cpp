@@ -0,0 +1,133 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include "Engine.h"
+
+#include <optional>
+#include <sstream>
+#include <utility>
+
+#include "nnue-probe/nnue.h"
+#include "Syzygy.h"
+#include "Thread.h"
+#include "UCI.h"
+
+extern ThreadPool gondor;
+extern std::string bookFiles;
+extern char syzygy_path[256];
+extern int syzygyCacheMB;
+
+Engine::Engine() : board(UCI::StartFEN), openingBook(bookFiles.c_str()) {
+    openingBook.closeBook();
+    bookOpen = openingBook.getBookOpen();
+
+    initReductions(UCI::nem, UCI::neb, UCI::tem, UCI::teb);
+
+    // the UCI loop may have set the hash up already, in which case we keep its size
+    if (table.sizeMB == 0) {
+        table.resize(256);
+    }
+
+    gondor.set(board, gondor.numThreads);
+
+    Tablebase::init(syzygy_path);
+    Tablebase::resizeCache(syzygyCacheMB);
+    NNUE::LoadNNUE();
+}
+
+Engine::~Engine() {
+    stop();
+    wait();
+    gondor.onInfo = nullptr;
+    gondor.onBestMove = nullptr;
+}
+
+bool Engine::setPosition(const std::string &fen, const std::vector<std::string> &moves) {
+    std::optional<libchess::Position> position = readPosition(fen, moves);
+    if (!position) {
+        return false;
+    }
+
+    wait();
+    board = *position;
+    return true;
+}
+
+std::optional<libchess::Position> Engine::readPosition(const std::string &fen, const std::vector<std::string> &moves) {
+    std::optional<libchess::Position> position = libchess::Position::from_fen(fen == "startpos" ? UCI::StartFEN : fen);
+    if (!position) {
+        return std::nullopt;
+    }
+
+    // the moves come from outside, so each one is checked against the legal moves before we play it
+    for (const std::string &text : moves) {
+        bool found = false;
+        for (libchess::Move move : position->legal_move_list()) {
+            if (move.to_str() == text) {
+                position->make_move(move);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return std::nullopt;
+        }
+    }
+    return position;
+}
+
+void Engine::setOption(const std::string &name, const std::string &value) {
+    wait();
+    std::stringstream stream("name " + name + " value " + value);
+    UCI::parseOption(stream, board, openingBook, bookOpen);
+}
+
+void Engine::newGame() {
+    wait();
+    if (!openingBook.getBookOpen()) {
+        openingBook.flipBookOpen();
+    }
+    table.clear();
+    gondor.clear();
+    board = *libchess::Position::from_fen(UCI::StartFEN);
+}
+
+void Engine::search(const Limits &limits, InfoCallback onInfo, BestMoveCallback onBestMove) {
+    wait();
+
+    UCI::GoLimits go = goLimits(limits, board);
+    gondor.onInfo = std::move(onInfo);
+    gondor.onBestMove = std::move(onBestMove);
+    UCI::startSearch(go, board, openingBook, bookOpen, gondor);
+}
+
+UCI::GoLimits Engine::goLimits(const Limits &limits, const libchess::Position &board) {
+    UCI::GoLimits go;
+    if (limits.start != std::chrono::steady_clock::time_point{}) {
+        go.start = limits.start;
+    }
+    bool white = !board.side_to_move();
+    go.time = white ? limits.whiteTime : limits.blackTime;
+    go.increment = white ? limits.whiteIncrement : limits.blackIncrement;
+    go.movesToGo = limits.movesToGo;
+    go.moveTime = limits.moveTime;
+    go.depth = limits.depth;
+    go.nodes = limits.nodes;
+    go.infinite = limits.infinite;
+    for (const std::string &text : limits.searchMoves) {
+        std::optional<libchess::Move> move = libchess::Move::from(text);
+        if (move) {
+            go.searchMoves.push_back(*move);
+        }
+    }
+    return go;
+}
+
+void Engine::stop() {
+    gondor.requestStop();
+}
+
+void Engine::wait() {
+    gondor.mainThread()->waitForSearchFinish();
+}
@@ -0,0 +1,89 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_ENGINE_H
+#define ANDURIL_ENGINE_ENGINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Anduril.h"
+#include "libchess/Position.h"
+#include "PolyglotBook.h"
+#include "UCI.h"
+
+// runs the engine inside another program, without going through stdin and stdout.
+// the search threads, hash table and options are global, so only one of these can exist at a time
+class Engine {
+public:
+    // what to search for.  Times are in milliseconds, -1 when not given
+    struct Limits {
+        int whiteTime = -1;
+        int blackTime = -1;
+        int whiteIncrement = 0;
+        int blackIncrement = 0;
+        int movesToGo = -1;
+        int moveTime = -1;
+        int depth = -1;
+        int64_t nodes = -1;
+        bool infinite = false;
+
+        // the root moves to search in UCI notation, empty for all of them
+        std::vector<std::string> searchMoves;
+
+        // when the request came in, the clock runs from here.  Left at its default it starts when search is called
+        std::chrono::steady_clock::time_point start{};
+    };
+
+    using InfoCallback = std::function<void(const SearchReport&)>;
+    using BestMoveCallback = std::function<void(libchess::Move best, libchess::Move ponder)>;
+
+    // loads the network and the tablebases from the current option values and sets up one search thread
+    Engine();
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    // sets the position from a FEN, or "startpos", and plays the moves on it.  Returns false and keeps the old
+    // position if the FEN doesn't parse or one of the moves isn't legal
+    bool setPosition(const std::string &fen, const std::vector<std::string> &moves = {});
+
+    // same as setoption name <name> value <value>
+    void setOption(const std::string &name, const std::string &value = "");
+
+    // same as ucinewgame, the hash and histories are cleared and the position goes back to the start
+    void newGame();
+
+    // starts a search and returns right away.  The callbacks run on the main search thread, onBestMove exactly
+    // once when the search is done, and an empty one prints the UCI line instead.  If OwnBook is on and the book
+    // has a move, onBestMove is called with it on this thread before search returns, and the position is left as
+    // it was.  Waits for the last search first if it is still going
+    void search(const Limits &limits, InfoCallback onInfo, BestMoveCallback onBestMove);
+
+    // asks the search to stop, the best move still comes through the callback
+    void stop();
+
+    // blocks until the last search has sent its best move
+    void wait();
+
+    const libchess::Position& position() const { return board; }
+
+    // the position setPosition would set, empty if it would fail
+    static std::optional<libchess::Position> readPosition(const std::string &fen, const std::vector<std::string> &moves);
+
+    // what limits asks for in UCI terms, with the clock of the side to move on board
+    static UCI::GoLimits goLimits(const Limits &limits, const libchess::Position &board);
+
+private:
+    libchess::Position board;
+    Book openingBook;
+    bool bookOpen = false;
+};
+
+#endif //ANDURIL_ENGINE_ENGINE_H
@@ -0,0 +1,36 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include "libchess/Position.h"
+
+// all of the lookup tables are generated at compile time so they can live in read only memory and cost nothing at startup
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::SQUARES = libchess::lookups::init::squares();
+
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::NORTH = libchess::lookups::init::north();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::SOUTH = libchess::lookups::init::south();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::EAST = libchess::lookups::init::east();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::WEST = libchess::lookups::init::west();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::NORTHWEST = libchess::lookups::init::northwest();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::SOUTHWEST = libchess::lookups::init::southwest();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::NORTHEAST = libchess::lookups::init::northeast();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::SOUTHEAST = libchess::lookups::init::southeast();
+constexpr std::array<std::array<libchess::Bitboard, 64>, 64> libchess::lookups::INTERVENING = libchess::lookups::init::intervening();
+
+constexpr std::array<std::array<libchess::Bitboard, 64>, 2> libchess::lookups::PAWN_ATTACKS = libchess::lookups::init::pawn_attacks();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::KNIGHT_ATTACKS = libchess::lookups::init::knight_attacks();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::KING_ATTACKS = libchess::lookups::init::king_attacks();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::BISHOP_ATTACKS = libchess::lookups::init::bishop_attacks();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::ROOK_ATTACKS = libchess::lookups::init::rook_attacks();
+constexpr std::array<libchess::Bitboard, 64> libchess::lookups::QUEEN_ATTACKS = libchess::lookups::init::queen_attacks();
+
+constexpr std::array<std::array<libchess::Bitboard, 64>, 64> libchess::lookups::FULL_RAY = libchess::lookups::init::full_ray();
+
+constexpr std::array<libchess::Bitboard, libchess::lookups::ROOK_TABLE_SIZE> libchess::lookups::rook_table = libchess::lookups::init::magic_table<libchess::lookups::ROOK_TABLE_SIZE>(libchess::constants::ROOK);
+constexpr std::array<libchess::Bitboard, libchess::lookups::BISHOP_TABLE_SIZE> libchess::lookups::bishop_table = libchess::lookups::init::magic_table<libchess::lookups::BISHOP_TABLE_SIZE>(libchess::constants::BISHOP);
+constexpr std::array<libchess::lookups::Magic, 64> libchess::lookups::rook_magics = libchess::lookups::init::magics(libchess::constants::ROOK, libchess::lookups::rook_table.data());
+constexpr std::array<libchess::lookups::Magic, 64> libchess::lookups::bishop_magics = libchess::lookups::init::magics(libchess::constants::BISHOP, libchess::lookups::bishop_table.data());
+constexpr std::array<std::array<uint8_t, 64>, 64> libchess::lookups::squareDistance = libchess::lookups::init::square_distance();
+
+constexpr std::array<std::uint64_t, libchess::cuckoo::SIZE> libchess::cuckoo::keys = libchess::cuckoo::init::cuckoo().keys;
+constexpr std::array<libchess::Move, libchess::cuckoo::SIZE> libchess::cuckoo::moves = libchess::cuckoo::init::cuckoo().moves;
@@ -0,0 +1,255 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include "Output.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+    // one piece of a line in the ring.  A line longer than a slot takes several slots in a row.
+    // the sequence says who owns the slot: it equals the position when a writer can fill it, the position plus one
+    // once it is filled, and the position plus the capacity once the writer thread has emptied it again
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        uint32_t length;
+        char text[256 - 16];
+    };
+
+    constexpr uint64_t CAPACITY = 4096;
+    constexpr size_t SLOT_TEXT = sizeof(Slot::text);
+
+    // the writer thread hands the OS this much at most in one call
+    constexpr size_t BATCH_SIZE = 1 << 16;
+
+    Slot ring[CAPACITY];
+
+    // the next position a line will be put in, and the next one the writer thread takes out
+    std::atomic<uint64_t> enqueuePos = 0;
+    uint64_t dequeuePos = 0;
+
+    // bumped after every line so the writer thread can sleep on it
+    std::atomic<uint32_t> pending = 0;
+    std::atomic<bool> stopping = false;
+
+    std::thread writer;
+    bool running = false;
+
+    // copies text into count slots starting at pos and publishes them, the newline goes at the very end
+    void fill(uint64_t pos, uint64_t count, const char *text, size_t length, bool newline) {
+        size_t total = length + newline;
+        size_t done = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            Slot &slot = ring[(pos + i) % CAPACITY];
+            size_t n = std::min(SLOT_TEXT, total - done);
+            size_t fromText = done < length ? std::min(n, length - done) : 0;
+            std::memcpy(slot.text, text + done, fromText);
+            if (fromText < n) {
+                slot.text[fromText] = '\n';
+            }
+            slot.length = uint32_t(n);
+            done += n;
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+    }
+
+    bool enqueue(const char *text, size_t length, bool newline, bool droppable) {
+        size_t total = length + newline;
+        if (total == 0) {
+            return true;
+        }
+
+        // a line that doesn't fit in the whole ring gets cut off, nothing we send comes close
+        uint64_t count = std::min<uint64_t>((total + SLOT_TEXT - 1) / SLOT_TEXT, CAPACITY);
+        if (count * SLOT_TEXT < total) {
+            length = count * SLOT_TEXT - newline;
+        }
+
+        uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            // the writer thread empties the slots in order, so if the last one we need is free all of them are
+            uint64_t last = pos + count - 1;
+            uint64_t sequence = ring[last % CAPACITY].sequence.load(std::memory_order_acquire);
+            if (sequence == last) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (sequence < last) {
+                // the ring is full
+                if (droppable) {
+                    return false;
+                }
+                std::this_thread::yield();
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+            else {
+                // somebody else took these slots
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(pos, count, text, length, newline);
+        pending.fetch_add(1, std::memory_order_release);
+        pending.notify_one();
+        return true;
+    }
+
+    void writeOut(const char *data, size_t size) {
+        // anything printed with printf has to come out before what we have
+        std::fflush(stdout);
+#ifdef _WIN32
+        std::fwrite(data, 1, size, stdout);
+        std::fflush(stdout);
+#else
+        while (size > 0) {
+            ssize_t n = ::write(STDOUT_FILENO, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            data += n;
+            size -= size_t(n);
+        }
+#endif
+    }
+
+    void writerLoop() {
+        std::vector<char> batch;
+        batch.reserve(BATCH_SIZE + SLOT_TEXT);
+
+        while (true) {
+            uint32_t seen = pending.load(std::memory_order_acquire);
+
+            // take every finished slot in order, stopping at one that is still empty or being filled
+            while (batch.size() < BATCH_SIZE) {
+                Slot &slot = ring[dequeuePos % CAPACITY];
+                if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                    break;
+                }
+                batch.insert(batch.end(), slot.text, slot.text + slot.length);
+                slot.sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+                dequeuePos++;
+            }
+
+            if (!batch.empty()) {
+                writeOut(batch.data(), batch.size());
+                batch.clear();
+                continue;
+            }
+
+            if (stopping.load(std::memory_order_acquire)) {
+                return;
+            }
+            pending.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    // lets the code that writes to std::cout go through the ring.  Every thread collects its own line,
+    // so lines from different threads can't get mixed together
+    class QueueBuffer : public std::streambuf {
+    public:
+        // sends whatever this thread has collected so far
+        void sendPending() {
+            std::string &line = pendingLine();
+            enqueue(line.data(), line.size(), false, false);
+            line.clear();
+        }
+
+    protected:
+        int overflow(int c) override {
+            if (c == traits_type::eof()) {
+                return traits_type::not_eof(c);
+            }
+            pendingLine().push_back(char(c));
+            if (c == '\n') {
+                sendPending();
+            }
+            return c;
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+            pendingLine().append(s, size_t(n));
+            if (n > 0 && s[n - 1] == '\n') {
+                sendPending();
+            }
+            return n;
+        }
+
+        int sync() override {
+            sendPending();
+            return 0;
+        }
+
+    private:
+        static std::string &pendingLine() {
+            thread_local std::string line;
+            return line;
+        }
+    };
+
+    QueueBuffer queueBuffer;
+    std::streambuf *coutBuffer = nullptr;
+}
+
+namespace Output {
+
+    void start() {
+        if (running) {
+            return;
+        }
+
+        for (uint64_t i = 0; i < CAPACITY; i++) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos = 0;
+        dequeuePos = 0;
+        stopping = false;
+
+        writer = std::thread(writerLoop);
+        coutBuffer = std::cout.rdbuf(&queueBuffer);
+        running = true;
+    }
+
+    void stop() {
+        if (!running) {
+            return;
+        }
+
+        queueBuffer.sendPending();
+        std::cout.rdbuf(coutBuffer);
+
+        stopping.store(true, std::memory_order_release);
+        pending.fetch_add(1, std::memory_order_release);
+        pending.notify_one();
+        writer.join();
+        running = false;
+    }
+
+    bool send(const char *text, size_t length, bool droppable) {
+        if (!running) {
+            std::cout.write(text, std::streamsize(length));
+            std::cout << std::endl;
+            return true;
+        }
+        return enqueue(text, length, true, droppable);
+    }
+
+}
@@ -0,0 +1,72 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_OUTPUT_H
+#define ANDURIL_ENGINE_OUTPUT_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "libchess/Move.h"
+
+// everything we send to the GUI goes through here.  Lines are copied into a lock-free ring and a writer thread
+// hands them to the OS in batches, so a search thread never waits on a slow pipe
+namespace Output {
+
+    // starts the writer thread and points std::cout at the queue, so the rest of the engine can keep using it
+    void start();
+
+    // writes out everything still queued, then stops the writer and gives std::cout its own buffer back
+    void stop();
+
+    // queues a single line, the newline is added here.  Droppable lines are thrown away when the queue is full
+    // instead of waiting for room, returns false if that happened
+    bool send(const char *text, size_t length, bool droppable = false);
+
+    // a line being put together in a fixed buffer.  Numbers are written with to_chars, so building it never allocates.
+    // anything past the end of the buffer is cut off
+    class Line {
+    public:
+        Line &operator<<(std::string_view s) {
+            size_t n = std::min(s.size(), SIZE - length);
+            std::memcpy(text + length, s.data(), n);
+            length += n;
+            return *this;
+        }
+
+        template<typename T> requires (std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>)
+        Line &operator<<(T value) {
+            auto [end, error] = std::to_chars(text + length, text + SIZE, value);
+            if (error == std::errc()) {
+                length = end - text;
+            }
+            return *this;
+        }
+
+        Line &operator<<(libchess::Move move) {
+            if (length + 5 <= SIZE) {
+                length = move.write(text + length) - text;
+            }
+            return *this;
+        }
+
+        bool send(bool droppable = false) const { return Output::send(text, length, droppable); }
+
+        // the line so far, for sending it somewhere else than the GUI
+        std::string_view view() const { return {text, length}; }
+
+    private:
+        static constexpr size_t SIZE = 2048;
+
+        char text[SIZE];
+        size_t length = 0;
+    };
+
+}
+
+#endif //ANDURIL_ENGINE_OUTPUT_H
@@ -2,86 +2,129 @@
 // Created by 80hugkev on 6/8/2022.
 //
 
+#include <cassert>
 #include <iostream>
 #include <random>
 
 #include "Anduril.h"
 #include "PolyglotBook.h"
 #include "ZobristHasher.h"
+#include "nnue-probe/misc.h"
 
-// opens a book
-bool Book::readBook(const char *file) {
-    book = fopen(file, "rb");
+struct Book::BookFile {
+    FD fd;
+    map_t map;
+    const bookEntry *entries;
+    size_t numEntries;
+};
 
-    if (book == nullptr) {
-        //std::cout << "Failed to read book, file did not open" << std::endl;
-        bookOpen = false;
-        return false;
-    }
-    else {
-        fseek(book, 0, SEEK_END);
-        long position = ftell(book);
-
-        if (position < sizeof(bookEntry)) {
-            //std::cout << "Failed to read book." << std::endl;
-            bookOpen = false;
-            return false;
+Book::Book(const char *files) {
+    bookOpen = readBook(files);
+}
+
+Book::~Book() {
+    freeBook();
+}
+
+// opens every book in the list
+bool Book::readBook(const char *files) {
+    freeBook();
+
+    std::string list = files;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(';', start);
+        if (end == std::string::npos) {
+            end = list.size();
         }
 
-        numEntries = position / sizeof(bookEntry);
+        if (end > start) {
+            mapBook(list.substr(start, end - start));
+        }
+        start = end + 1;
+    }
 
-        entries = (bookEntry*)malloc(numEntries * sizeof(bookEntry));
-        rewind(book);
+    bookOpen = !books.empty();
+    return bookOpen;
+}
 
-        size_t returnValue;
-        returnValue = fread(entries, sizeof(bookEntry), numEntries, book);
+// maps a single book read only.  Polyglot books are sorted by key, so we never need to read more than a few pages
+bool Book::mapBook(const std::string &file) {
+    BookFile book;
+    book.fd = open_file(file.c_str());
 
-        //std::cout << returnValue << " Entries read from file" << std::endl;
+    if (book.fd == FD_ERR) {
+        //std::cout << "Failed to read book, file did not open" << std::endl;
+        return false;
     }
 
+    size_t size = file_size(book.fd);
+    if (size < sizeof(bookEntry)) {
+        //std::cout << "Failed to read book." << std::endl;
+        close_file(book.fd);
+        return false;
+    }
+
+    book.entries = static_cast<const bookEntry*>(map_file(book.fd, &book.map));
+    if (!book.entries) {
+        close_file(book.fd);
+        return false;
+    }
+    book.numEntries = size / sizeof(bookEntry);
+
+    books.push_back(book);
     return true;
 }
 
-// closes the book
+// closes the books
 void Book::freeBook() {
-    if (entries) {
-        free(entries);
+    for (BookFile &book : books) {
+        unmap_file(book.entries, book.map);
+        close_file(book.fd);
+    }
+    books.clear();
+}
+
+// binary search for the lower bound of the key, keys are stored big endian
+const bookEntry* Book::firstEntry(const BookFile &file, uint64_t key) {
+    size_t low = 0, high = file.numEntries;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (endian_swap_u64(file.entries[mid].key) < key) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
     }
+    return file.entries + low;
 }
 
 // finds and returns a book move for the position
 libchess::Move Book::getBookMove(libchess::Position &board) {
-    uint64_t key = Zobrist::zobristHash(board);
-    int index = 0;
-    bookEntry *entry;
-    uint16_t move;
-    libchess::Move bookMoves[32];
+    // our hash is built from the polyglot randoms, so there is no need to walk the board for the key
+    uint64_t key = board.hash();
+    assert(key == Zobrist::zobristHash(board));
+    std::vector<libchess::Move> bookMoves;
     libchess::Move tempMove;
-    int count = 0;
     std::random_device random;
 
-    for (entry = getEntries(); entry < getEntries() + getNumEntries(); entry++) {
-        if (key == endian_swap_u64(entry->key)) {
-            move = endian_swap_u16(entry->move);
-            tempMove = convertPolyToInternal(move, board);
+    // the first book that knows the position gets to pick the move
+    for (const BookFile &book : books) {
+        const bookEntry *end = book.entries + book.numEntries;
+        for (const bookEntry *entry = firstEntry(book, key); entry < end && endian_swap_u64(entry->key) == key; entry++) {
+            tempMove = convertPolyToInternal(endian_swap_u16(entry->move), board);
             if (tempMove.value() != 0) {
-                bookMoves[count++] = tempMove;
-                if (count > 32) {
-                    break;
-                }
+                bookMoves.push_back(tempMove);
             }
-
         }
-    }
 
-    if (count != 0) {
-        tempMove = bookMoves[random() % count];
-    }
-    else {
-        tempMove = libchess::Move(0);
+        if (!bookMoves.empty()) {
+            return bookMoves[random() % bookMoves.size()];
+        }
     }
 
-    return tempMove;
+    return libchess::Move(0);
 }
 
 libchess::Move Book::convertPolyToInternal(uint16_t move, libchess::Position &board) {
@@ -6,6 +6,8 @@
 #define ANDURIL_ENGINE_POLYGLOTBOOK_H
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include "libchess/Position.h"
 
@@ -19,19 +21,23 @@ struct bookEntry {
 
 class Book {
 public:
-    Book(const char *file) { bookOpen = readBook(file); }
+    // takes a list of books separated by ';', the books are probed in the order they are listed
+    Book(const char *files);
 
-    ~Book() { freeBook(); }
+    ~Book();
+
+    // the books are memory mapped, so copies would unmap them out from under us
+    Book(const Book&) = delete;
+    Book& operator=(const Book&) = delete;
 
     // getters and setters
-    inline bookEntry* getEntries() { return entries; }
-    inline long getNumEntries() const { return numEntries; }
     inline bool getBookOpen() const { return bookOpen; }
     inline void flipBookOpen() { bookOpen = !bookOpen; }
     inline void closeBook() { bookOpen = false; }
     inline void openBook() { bookOpen = true; }
 
-    bool readBook(const char *file);
+    // maps every book in the list, returns true if at least one of them could be used
+    bool readBook(const char *files);
 
     void freeBook();
 
@@ -48,13 +54,17 @@ public:
 
 private:
 
-    FILE *book;
+    // a single read only mapping of a book file, defined with the platform specific bits in PolyglotBook.cpp
+    struct BookFile;
 
-    bool bookOpen;
+    bool mapBook(const std::string &file);
 
-    bookEntry *entries = nullptr;
+    // finds the first entry in the book with the key, or the end of the book if there are none
+    const bookEntry* firstEntry(const BookFile &file, uint64_t key);
 
-    long numEntries;
+    std::vector<BookFile> books;
+
+    bool bookOpen;
 
     std::unordered_map<int, std::string>intToFile = {{0, "a"},
                                                      {1, "b"},
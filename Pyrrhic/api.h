@@ -90,6 +90,18 @@ struct TbRootMoves {
 bool tb_init(const char *_path);
 void tb_free(void);
 
+/// Runs body(i, data) for every 0 <= i < count, possibly on several threads at
+/// once.  tb_init() uses it to look for the table files, the default is a loop
+
+typedef void (*tb_parallel_for_t)(int count, void (*body)(int i, void *data), void *data);
+void tb_set_parallel_for(tb_parallel_for_t fn);
+
+/// Maps the WDL tables with the fewest pieces first and asks the OS to read
+/// them in, until maxBytes worth of files are done or stop() returns true.
+/// Returns the number of bytes it went through
+
+size_t tb_warmup(size_t maxBytes, bool (*stop)(void));
+
 /// Pyrrhic Tablebase Probing Functions
 
 unsigned tb_probe_wdl(
@@ -78,25 +78,14 @@ typedef HANDLE map_t;
 #define DECOMP64
 
 #if defined(__cplusplus) && (__cplusplus >= 201103L)
-    #include <mutex>
-    #define LOCK_T std::mutex
-    #define LOCK_INIT(x)
-    #define LOCK_DESTROY(x)
-    #define LOCK(x) x.lock()
-    #define UNLOCK(x) x.unlock()
+    #include <thread>
+    #define TB_YIELD() std::this_thread::yield()
 #else
     #ifndef _WIN32
-        #define LOCK_T pthread_mutex_t
-        #define LOCK_INIT(x) pthread_mutex_init(&(x), NULL)
-        #define LOCK_DESTROY(x) pthread_mutex_destroy(&(x))
-        #define LOCK(x) pthread_mutex_lock(&(x))
-        #define UNLOCK(x) pthread_mutex_unlock(&(x))
+        #include <sched.h>
+        #define TB_YIELD() sched_yield()
     #else
-        #define LOCK_T HANDLE
-        #define LOCK_INIT(x) do { x = CreateMutex(NULL, FALSE, NULL); } while (0)
-        #define LOCK_DESTROY(x) CloseHandle(x)
-        #define LOCK(x) WaitForSingleObject(x, INFINITE)
-        #define UNLOCK(x) ReleaseMutex(x)
+        #define TB_YIELD() SwitchToThread()
     #endif
 #endif
 
@@ -137,7 +126,6 @@ static size_t file_size(FD fd) {
 #endif
 }
 
-static LOCK_T tbMutex;
 static int initialized = 0;
 static int numPaths = 0;
 static char *pathString = NULL;
@@ -287,14 +275,21 @@ struct EncInfo {
   uint8_t norm[TB_PIECES];
 };
 
+// the life of each table in an entry.  Only the thread that moves it from
+// TB_UNINIT to TB_INITIALISING sets the table up, probes of a table in
+// TB_READY only do a single acquire load
+enum { TB_UNINIT, TB_INITIALISING, TB_READY, TB_FAILED };
+
 struct BaseEntry {
   uint64_t key;
+  char name[16];
+  size_t wdlSize;
   uint8_t *data[3];
   map_t mapping[3];
 #ifdef __cplusplus
-  atomic<bool> ready[3];
+  atomic<uint8_t> state[3];
 #else
-  atomic_bool ready[3];
+  _Atomic uint8_t state[3];
 #endif
   uint8_t num;
   bool symmetric, hasPawns, hasDtm, hasDtz;
@@ -466,23 +461,25 @@ static void prt_str(const PyrrhicPosition *pos, char *str, int flip) {
     *str++ = 0;
 }
 
-static int test_tb(const char *str, const char *suffix) {
+// returns the size of the file, or 0 if it is missing or incomplete
+static size_t test_tb(const char *str, const char *suffix) {
 
     FD fd = open_tb(str, suffix);
+    size_t size = 0;
 
     if (fd != FD_ERR) {
 
-        size_t size = file_size(fd);
+        size = file_size(fd);
         close_tb(fd);
 
         if ((size & 63) != 16) {
             fprintf(stderr, "Incomplete tablebase file %s.%s\n", str, suffix);
             printf("info string Incomplete tablebase file %s.%s\n", str, suffix);
-            fd = FD_ERR;
+            size = 0;
         }
     }
 
-    return fd != FD_ERR;
+    return size;
 }
 
 static void *map_tb(const char *name, const char *suffix, map_t *mapping) {
@@ -516,16 +513,54 @@ static void add_to_hash(struct BaseEntry *ptr, uint64_t key) {
 #define tb_pchr(i) pyrrhic_piece_to_char[PYRRHIC_QUEEN - (i)]
 #define PYRRHIC_SWAP(a,b) {int tmp=a;a=b;b=tmp;}
 
-static void init_tb(char *str)
+// a table tb_init looks for.  The files are tested for on several threads, then
+// the ones that were found are registered one at a time in the original order
+struct TbCandidate {
+  char name[16];
+  size_t size[3];
+};
+
+static struct TbCandidate *candidates;
+static int numCandidates;
+
+static void add_candidate(const char *str)
+{
+  strcpy(candidates[numCandidates++].name, str);
+}
+
+static void test_candidate(int i, void *data)
+{
+  struct TbCandidate *c = &((struct TbCandidate *)data)[i];
+  c->size[WDL] = test_tb(c->name, tbSuffix[WDL]);
+  c->size[DTM] = c->size[WDL] ? test_tb(c->name, tbSuffix[DTM]) : 0;
+  c->size[DTZ] = c->size[WDL] ? test_tb(c->name, tbSuffix[DTZ]) : 0;
+}
+
+static void serial_for(int count, void (*body)(int i, void *data), void *data)
 {
-  if (!test_tb(str, tbSuffix[WDL]))
+  for (int i = 0; i < count; i++)
+    body(i, data);
+}
+
+static tb_parallel_for_t tbParallelFor = serial_for;
+
+void tb_set_parallel_for(tb_parallel_for_t fn)
+{
+  tbParallelFor = fn ? fn : serial_for;
+}
+
+static void init_tb(const struct TbCandidate *c)
+{
+  if (!c->size[WDL])
     return;
 
+  const char *str = c->name;
+
   int pcs[16];
   for (int i = 0; i < 16; i++)
     pcs[i] = 0;
   int color = 0;
-  for (char *s = str; *s; s++)
+  for (const char *s = str; *s; s++)
     if (*s == 'v')
       color = 8;
     else {
@@ -545,14 +580,16 @@ static void init_tb(char *str)
                                   : &pieceEntry[tbNumPiece++].be;
   be->hasPawns = hasPawns;
   be->key = key;
+  strcpy(be->name, str);
+  be->wdlSize = c->size[WDL];
   be->symmetric = key == key2;
   be->num = 0;
   for (int i = 0; i < 16; i++)
     be->num += pcs[i];
 
   numWdl++;
-  numDtm += be->hasDtm = test_tb(str, tbSuffix[DTM]);
-  numDtz += be->hasDtz = test_tb(str, tbSuffix[DTZ]);
+  numDtm += be->hasDtm = c->size[DTM] != 0;
+  numDtz += be->hasDtz = c->size[DTZ] != 0;
 
   if (be->num > TB_MaxCardinality) {
     TB_MaxCardinality = be->num;
@@ -563,7 +600,7 @@ static void init_tb(char *str)
     }
 
   for (int type = 0; type < 3; type++)
-    atomic_init(&be->ready[type], false);
+    atomic_init(&be->state[type], (uint8_t)TB_UNINIT);
 
   if (!be->hasPawns) {
     int j = 0;
@@ -600,7 +637,8 @@ struct EncInfo *first_ei(struct BaseEntry *be, const int type)
 static void free_tb_entry(struct BaseEntry *be)
 {
   for (int type = 0; type < 3; type++) {
-    if (atomic_load_explicit(&be->ready[type], memory_order_relaxed)) {
+    uint8_t state = atomic_load_explicit(&be->state[type], memory_order_relaxed);
+    if (state == TB_READY) {
       unmap_file((void*)(be->data[type]), be->mapping[type]);
       int num = num_tables(be, type);
       struct EncInfo *ei = first_ei(be, type);
@@ -609,8 +647,8 @@ static void free_tb_entry(struct BaseEntry *be)
         if (type != DTZ)
           free(ei[num + t].precomp);
       }
-      atomic_store_explicit(&be->ready[type], false, memory_order_relaxed);
     }
+    atomic_store_explicit(&be->state[type], (uint8_t)TB_UNINIT, memory_order_relaxed);
   }
 }
 
@@ -636,8 +674,6 @@ bool tb_init(const char *path)
     for (int i = 0; i < tbNumPawn; i++)
       free_tb_entry((struct BaseEntry *)&pawnEntry[i]);
 
-    LOCK_DESTROY(tbMutex);
-
     pathString = NULL;
     numWdl = numDtm = numDtz = 0;
   }
@@ -664,8 +700,6 @@ bool tb_init(const char *path)
     while (pathString[j]) j++;
   }
 
-  LOCK_INIT(tbMutex);
-
   tbNumPiece = tbNumPawn = 0;
   TB_MaxCardinality = TB_MaxCardinalityDTM = 0;
 
@@ -683,38 +717,45 @@ bool tb_init(const char *path)
     tbHash[i].ptr = NULL;
   }
 
+  candidates = (struct TbCandidate*)malloc((TB_MAX_PIECE + TB_MAX_PAWN) * sizeof(*candidates));
+  if (!candidates) {
+    fprintf(stderr, "Out of memory.\n");
+    exit(EXIT_FAILURE);
+  }
+  numCandidates = 0;
+
   char str[16];
   int i, j, k, l, m;
 
   for (i = 0; i < 5; i++) {
     snprintf(str, 16, "K%cvK", tb_pchr(i));
-    init_tb(str);
+    add_candidate(str);
   }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++) {
       snprintf(str, 16, "K%cvK%c", tb_pchr(i), tb_pchr(j));
-      init_tb(str);
+      add_candidate(str);
     }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++) {
       snprintf(str, 16, "K%c%cvK", tb_pchr(i), tb_pchr(j));
-      init_tb(str);
+      add_candidate(str);
     }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++)
       for (k = 0; k < 5; k++) {
         snprintf(str, 16, "K%c%cvK%c", tb_pchr(i), tb_pchr(j), tb_pchr(k));
-        init_tb(str);
+        add_candidate(str);
       }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++)
       for (k = j; k < 5; k++) {
         snprintf(str, 16, "K%c%c%cvK", tb_pchr(i), tb_pchr(j), tb_pchr(k));
-        init_tb(str);
+        add_candidate(str);
       }
 
   // 6- and 7-piece TBs make sense only with a 64-bit address space
@@ -726,7 +767,7 @@ bool tb_init(const char *path)
       for (k = i; k < 5; k++)
         for (l = (i == k) ? j : k; l < 5; l++) {
           snprintf(str, 16, "K%c%cvK%c%c", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l));
-          init_tb(str);
+          add_candidate(str);
         }
 
   for (i = 0; i < 5; i++)
@@ -734,7 +775,7 @@ bool tb_init(const char *path)
       for (k = j; k < 5; k++)
         for (l = 0; l < 5; l++) {
           snprintf(str, 16, "K%c%c%cvK%c", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l));
-          init_tb(str);
+          add_candidate(str);
         }
 
   for (i = 0; i < 5; i++)
@@ -742,7 +783,7 @@ bool tb_init(const char *path)
       for (k = j; k < 5; k++)
         for (l = k; l < 5; l++) {
           snprintf(str, 16, "K%c%c%c%cvK", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l));
-          init_tb(str);
+          add_candidate(str);
         }
 
   if (TB_PIECES < 7)
@@ -754,7 +795,7 @@ bool tb_init(const char *path)
         for (l = k; l < 5; l++)
           for (m = l; m < 5; m++) {
             snprintf(str, 16, "K%c%c%c%c%cvK", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l), tb_pchr(m));
-            init_tb(str);
+            add_candidate(str);
           }
 
   for (i = 0; i < 5; i++)
@@ -763,7 +804,7 @@ bool tb_init(const char *path)
         for (l = k; l < 5; l++)
           for (m = 0; m < 5; m++) {
             snprintf(str, 16, "K%c%c%c%cvK%c", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l), tb_pchr(m));
-            init_tb(str);
+            add_candidate(str);
           }
 
   for (i = 0; i < 5; i++)
@@ -772,11 +813,18 @@ bool tb_init(const char *path)
         for (l = 0; l < 5; l++)
           for (m = l; m < 5; m++) {
             snprintf(str, 16, "K%c%c%cvK%c%c", tb_pchr(i), tb_pchr(j), tb_pchr(k), tb_pchr(l), tb_pchr(m));
-            init_tb(str);
+            add_candidate(str);
           }
 
 finished:
 
+    // most of the time goes to opening files that aren't there, so spread it over the threads
+    tbParallelFor(numCandidates, test_candidate, candidates);
+    for (i = 0; i < numCandidates; i++)
+      init_tb(&candidates[i]);
+    free(candidates);
+    candidates = NULL;
+
     // Set TB_LARGEST, for backward compatibility with pre-7-man Fathom
     TB_LARGEST = TB_MaxCardinality;
     if (TB_MaxCardinalityDTM > TB_LARGEST) {
@@ -1515,6 +1563,70 @@ inline static int fill_squares(const PyrrhicPosition *pos, uint8_t *pc, bool fli
   return i;
 }
 
+// maps and sets up a table the first time it is needed.  The thread that claims
+// the table does the work, any others that want it meanwhile wait for it to be
+// published.  Different tables never wait on each other
+static bool ensure_table(struct BaseEntry *be, const char *str, const int type)
+{
+  uint8_t state = atomic_load_explicit(&be->state[type], memory_order_acquire);
+  while (state != TB_READY) {
+    if (state == TB_FAILED)
+      return false;
+
+    if (state == TB_UNINIT) {
+      if (atomic_compare_exchange_strong_explicit(&be->state[type], &state, (uint8_t)TB_INITIALISING,
+                                                  memory_order_acquire, memory_order_acquire)) {
+        bool ok = init_table(be, str, type);
+        atomic_store_explicit(&be->state[type], (uint8_t)(ok ? TB_READY : TB_FAILED), memory_order_release);
+        return ok;
+      }
+      continue;
+    }
+
+    // mapping a file only takes a moment, so there is no point in sleeping
+    TB_YIELD();
+    state = atomic_load_explicit(&be->state[type], memory_order_acquire);
+  }
+  return true;
+}
+
+// asks the OS to start reading a mapped file in
+static void prefetch_file(void *data, size_t size)
+{
+#ifndef _WIN32
+  #if defined(MADV_WILLNEED)
+  madvise(data, size, MADV_WILLNEED);
+  #endif
+#else
+  // there is no readahead hint to count on, so we touch every page ourselves
+  volatile uint8_t sink = 0;
+  for (size_t i = 0; i < size; i += 4096)
+    sink ^= ((uint8_t *)data)[i];
+  (void)sink;
+#endif
+}
+
+size_t tb_warmup(size_t maxBytes, bool (*stop)(void))
+{
+  size_t warmed = 0;
+
+  // every longer endgame turns into the smaller ones, so those get probed the most
+  for (int num = 2; num <= TB_MaxCardinality; num++) {
+    for (int i = 0; i < tbNumPiece + tbNumPawn; i++) {
+      struct BaseEntry *be = i < tbNumPiece ? &pieceEntry[i].be : &pawnEntry[i - tbNumPiece].be;
+      if (be->num != num)
+        continue;
+      if ((stop && stop()) || warmed + be->wdlSize > maxBytes)
+        return warmed;
+      if (!ensure_table(be, be->name, WDL))
+        continue;
+      prefetch_file(be->data[WDL], be->wdlSize);
+      warmed += be->wdlSize;
+    }
+  }
+  return warmed;
+}
+
 int probe_table(const PyrrhicPosition *pos, int s, int *success, const int type)
 {
   // Obtain the position's material-signature key
@@ -1539,21 +1651,14 @@ int probe_table(const PyrrhicPosition *pos, int s, int *success, const int type)
     return 0;
   }
 
-  // Use double-checked locking to reduce locking overhead
-  if (!atomic_load_explicit(&be->ready[type], memory_order_acquire)) {
-    LOCK(tbMutex);
-    if (!atomic_load_explicit(&be->ready[type], memory_order_relaxed)) {
-      char str[16];
-      prt_str(pos, str, be->key != key);
-      if (!init_table(be, str, type)) {
-        tbHash[hashIdx].ptr = NULL; // mark as deleted
-        *success = 0;
-        UNLOCK(tbMutex);
-        return 0;
-      }
-      atomic_store_explicit(&be->ready[type], true, memory_order_release);
+  // a table that failed to load stays failed until the tables are loaded again
+  if (atomic_load_explicit(&be->state[type], memory_order_acquire) != TB_READY) {
+    char str[16];
+    prt_str(pos, str, be->key != key);
+    if (!ensure_table(be, str, type)) {
+      *success = 0;
+      return 0;
     }
-    UNLOCK(tbMutex);
   }
 
   bool bside, flip;
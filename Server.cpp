@@ -0,0 +1,740 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include "Server.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+namespace Server {
+
+    void run(const char* path, int, int) {
+        std::cout << "info string the server needs UNIX sockets, it can't serve on " << path << std::endl;
+    }
+
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Engine.h"
+#include "Output.h"
+#include "Thread.h"
+#include "TimeManager.h"
+#include "UCI.h"
+
+extern int moveOverhead;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // the write end of a pipe the poll loop watches, so a thread that left output behind can have it look again
+    int wakeFd = -1;
+
+    void wakePollLoop() {
+        char byte = 0;
+        [[maybe_unused]] ssize_t n = write(wakeFd, &byte, 1);
+    }
+
+    // one client.  Its socket doesn't block: lines go into an output buffer, as much of it as the socket takes is
+    // written right away and the poll loop writes the rest once there is room.  So a client that stops reading
+    // never holds up the search or the other connections.  The reading is done by the poll loop alone
+    struct Connection {
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection() { close(fd); }
+
+        // droppable lines are thrown away once the client falls behind.  Anything else is kept, unless the client
+        // is so far behind that it must have stopped reading, then the connection is closed
+        void send(std::string_view line, bool droppable = false) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed || (droppable && output.size() > DROP_AFTER)) {
+                return;
+            }
+            if (output.size() + line.size() > MAX_OUTPUT) {
+                closed = true;
+                wakePollLoop();
+                return;
+            }
+
+            // if there was output left already the poll loop has been told about it
+            bool waiting = !output.empty();
+            output.append(line);
+            if (!waiting) {
+                flushLocked();
+                if (!output.empty() || closed) {
+                    wakePollLoop();
+                }
+            }
+        }
+
+        // called by the poll loop when the socket has room again
+        void flush() {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushLocked();
+        }
+
+        bool pending() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return !output.empty();
+        }
+
+        int fd;
+        std::mutex mutex;
+        bool closed = false;
+
+        // what we have read past the last full line
+        std::string input;
+
+    private:
+        static constexpr size_t DROP_AFTER = 1 << 16;
+        static constexpr size_t MAX_OUTPUT = 1 << 22;
+
+        void flushLocked() {
+            size_t sent = 0;
+            while (sent < output.size()) {
+                ssize_t n = ::send(fd, output.data() + sent, output.size() - sent, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        closed = true;
+                        output.clear();
+                        return;
+                    }
+                    break;
+                }
+                sent += size_t(n);
+            }
+            output.erase(0, sent);
+        }
+
+        std::string output;
+    };
+
+    class Slot;
+
+    // the longest a search without a clock may run, go infinite included
+    constexpr int MAX_SEARCH_MS = 10000;
+
+    // a game, along with how long its searches waited and took
+    struct Session {
+        std::string name;
+        std::shared_ptr<Connection> connection;
+
+        // the position from the last position command, and the hash table tag of the game
+        std::string fen = "startpos";
+        std::vector<std::string> moves;
+        uint64_t tag = 0;
+
+        // the slot the game searches on
+        Slot *slot = nullptr;
+
+        // set from go until the bestmove is sent
+        std::atomic<bool> busy = false;
+        std::atomic<bool> stopRequested = false;
+        std::atomic<bool> closed = false;
+
+        std::mutex metricsMutex;
+        int searches = 0;
+        int late = 0;
+        double queueTotal = 0, queueMax = 0;
+        double latencyTotal = 0, latencyMax = 0;
+
+        // nothing more goes out once the game is closed
+        void send(std::string_view line, bool droppable = false) {
+            if (!closed) {
+                Output::Line out;
+                out << name << " " << line << "\n";
+                connection->send(out.view(), droppable);
+            }
+        }
+    };
+
+    // a go command waiting for its turn, with everything it needs copied out of the session
+    struct SearchRequest {
+        std::shared_ptr<Session> session;
+        std::string fen;
+        std::vector<std::string> moves;
+        uint64_t tag;
+        Engine::Limits limits;
+    };
+
+    // a share of the threads with a pool of its own, so its threads have their own histories.  Every game is put on
+    // one slot when it is made and stays there.  A slot runs the searches of its games one after another on its own
+    // thread, while the other slots search theirs at the same time
+    class Slot {
+    public:
+        explicit Slot(int threads) : board(UCI::StartFEN), book(""), thread(&Slot::loop, this) {
+            resize(threads);
+        }
+
+        // the jobs still queued are run first, searches of closed games return right away
+        ~Slot() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                exiting = true;
+                if (running) {
+                    pool.requestStop();
+                }
+            }
+            cv.notify_one();
+            thread.join();
+        }
+
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            cv.notify_one();
+        }
+
+        // stops the search if it belongs to this session
+        void stop(const Session *session) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (running == session) {
+                pool.requestStop();
+            }
+        }
+
+        void search(const SearchRequest &request);
+
+        // only while nothing is searching on the slot
+        void resize(int threads) {
+            pool.numThreads = threads;
+            pool.set(board, threads);
+        }
+
+        // same as the histories being cleared by ucinewgame, only while nothing is searching on the slot
+        void clearHistories() {
+            pool.clear();
+        }
+
+        // games on the slot, only used by the server thread
+        int games = 0;
+
+    private:
+        void loop() {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [this]() { return exiting || !jobs.empty(); });
+                    if (jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+        libchess::Position board;
+        ThreadPool pool;
+
+        // we never play from the book here, but starting a search needs one
+        Book book;
+        bool bookOpen = false;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs;
+        bool exiting = false;
+
+        // the session whose search is on the threads right now
+        const Session *running = nullptr;
+
+        std::thread thread;
+    };
+
+    // whether the time this search would have been allowed has already gone by in the queue
+    bool pastDeadline(const Engine::Limits &limits, bool white) {
+        int time = white ? limits.whiteTime : limits.blackTime;
+        if (limits.infinite || (time < 0 && limits.moveTime < 0)) {
+            return false;
+        }
+
+        TimeManager clock;
+        clock.init(limits.start, time, white ? limits.whiteIncrement : limits.blackIncrement, limits.movesToGo,
+                   limits.moveTime, moveOverhead);
+        return Clock::now() >= clock.hardDeadline();
+    }
+
+    void Slot::search(const SearchRequest &request) {
+        Session &session = *request.session;
+        if (session.closed) {
+            return;
+        }
+
+        auto started = Clock::now();
+        std::optional<libchess::Position> position = Engine::readPosition(request.fen, request.moves);
+        if (!position) {
+            session.busy = false;
+            session.send("info string bad fen or illegal move in the position");
+            session.send("bestmove 0000");
+            return;
+        }
+        board = *position;
+        pool.setHashTag(request.tag);
+
+        pool.onInfo = [&session](const SearchReport &report) {
+            Output::Line info;
+            UCI::writeInfo(info, report, report.pv);
+            session.send(info.view(), true);
+        };
+
+        pool.onBestMove = [&session, &request, started](libchess::Move best, libchess::Move ponder) {
+            auto now = Clock::now();
+            double queued = std::chrono::duration<double, std::milli>(started - request.limits.start).count();
+            double latency = std::chrono::duration<double, std::milli>(now - request.limits.start).count();
+            {
+                std::lock_guard<std::mutex> lock(session.metricsMutex);
+                session.searches++;
+                session.queueTotal += queued;
+                session.queueMax = std::max(session.queueMax, queued);
+                session.latencyTotal += latency;
+                session.latencyMax = std::max(session.latencyMax, latency);
+            }
+
+            // the client may send its next go as soon as it sees this, so the session has to be free first
+            session.busy = false;
+            Output::Line reply;
+            reply << "bestmove ";
+            if (best.value() != 0) {
+                reply << best;
+            }
+            else {
+                reply << "0000";
+            }
+            if (ponder.value() != 0) {
+                reply << " ponder " << ponder;
+            }
+            session.send(reply.view());
+        };
+
+        {
+            // a stop either comes before this and is seen here, or after it and finds the search running
+            std::lock_guard<std::mutex> lock(mutex);
+            running = &session;
+
+            // a search stopped while it was still queued, or one that waited past its hard limit, only gets the
+            // first depth with no clock, so there is still a move to send
+            Engine::Limits limits = request.limits;
+
+            // a search without a clock would hold the slot until its client sends stop, so it gets a slice of time
+            // instead and the other games of the slot still get their turn
+            int time = board.side_to_move() ? limits.blackTime : limits.whiteTime;
+            if (limits.infinite || (time < 0 && (limits.moveTime < 0 || limits.moveTime > MAX_SEARCH_MS))) {
+                limits.infinite = false;
+                limits.moveTime = MAX_SEARCH_MS;
+                Output::Line note;
+                note << "info string searches without a clock stop after " << MAX_SEARCH_MS << " ms here";
+                session.send(note.view());
+            }
+
+            bool late = pastDeadline(limits, !board.side_to_move());
+            if (late) {
+                std::lock_guard<std::mutex> metricsLock(session.metricsMutex);
+                session.late++;
+            }
+            if (late || session.stopRequested) {
+                limits = Engine::Limits();
+                limits.depth = 1;
+                limits.start = request.limits.start;
+            }
+            UCI::startSearch(Engine::goLimits(limits, board), board, book, bookOpen, pool);
+        }
+        pool.mainThread()->waitForSearchFinish();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running = nullptr;
+    }
+
+    // a tag for a new game, spread out over the whole 64 bits with splitmix64
+    uint64_t nextTag() {
+        static uint64_t state = 0;
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    void parsePosition(std::stringstream &stream, Session &session) {
+        std::string token, fen;
+        stream >> token;
+        if (token == "startpos") {
+            fen = "startpos";
+            stream >> token;
+        }
+        else if (token == "fen") {
+            while (stream >> token && token != "moves") {
+                fen += token + " ";
+            }
+        }
+        else {
+            return;
+        }
+
+        session.fen = fen;
+        session.moves.clear();
+        while (stream >> token) {
+            session.moves.push_back(token);
+        }
+    }
+
+    Engine::Limits parseGo(std::stringstream &stream, Session &session) {
+        Engine::Limits limits;
+        limits.start = Clock::now();
+
+        std::string token;
+        bool readingMoves = false;
+        while (stream >> token) {
+            if (readingMoves) {
+                if (libchess::Move::from(token)) {
+                    limits.searchMoves.push_back(token);
+                    continue;
+                }
+                readingMoves = false;
+            }
+
+            if (token == "searchmoves") {
+                readingMoves = true;
+            }
+            else if (token == "infinite") {
+                limits.infinite = true;
+            }
+            // a pondering game would hold the threads until ponderhit, so it gets an ordinary search instead
+            else if (token == "ponder") {
+                session.send("info string pondering is not supported here, searching normally");
+            }
+            else if (token == "wtime") {
+                stream >> limits.whiteTime;
+            }
+            else if (token == "btime") {
+                stream >> limits.blackTime;
+            }
+            else if (token == "winc") {
+                stream >> limits.whiteIncrement;
+            }
+            else if (token == "binc") {
+                stream >> limits.blackIncrement;
+            }
+            else if (token == "movestogo") {
+                stream >> limits.movesToGo;
+            }
+            else if (token == "movetime") {
+                stream >> limits.moveTime;
+            }
+            else if (token == "depth") {
+                stream >> limits.depth;
+            }
+            else if (token == "nodes") {
+                stream >> limits.nodes;
+            }
+        }
+        return limits;
+    }
+
+    // the games of every connection, only used by the server thread
+    struct Dispatcher {
+        Dispatcher(Engine &engine, int slotCount, int threads) : engine(engine) {
+            for (int i = 0; i < slotCount; i++) {
+                slots.push_back(std::make_unique<Slot>(threads));
+            }
+        }
+
+        // every session of a connection is closed with it, a search it was running is stopped
+        void closeSessions(Connection &connection) {
+            for (auto &[name, session] : sessions[&connection]) {
+                closeSession(*session);
+            }
+            sessions.erase(&connection);
+        }
+
+        void closeSession(Session &session) {
+            session.closed = true;
+            session.slot->stop(&session);
+            session.slot->games--;
+        }
+
+        void handle(const std::shared_ptr<Connection> &connection, const std::string &line) {
+            std::stringstream stream(line);
+            std::string name, token;
+            if (!(stream >> name)) {
+                return;
+            }
+
+            if (name == "quit") {
+                quit = true;
+                return;
+            }
+
+            // options are global, so every slot finishes the searches queued before the option and waits for the
+            // others, then the last one to get there changes it.  Threads is the number of threads of every slot
+            if (name == "setoption") {
+                std::string option, value;
+                stream >> token;
+                while (stream >> token && token != "value") {
+                    option += (option.empty() ? "" : " ") + token;
+                }
+                std::getline(stream >> std::ws, value);
+
+                auto change = [this, option, value]() noexcept {
+                    if (option == "Threads") {
+                        int threads = std::clamp(std::atoi(value.c_str()), 1, 1024);
+                        for (auto &slot : slots) {
+                            slot->resize(threads);
+                        }
+                    }
+                    else {
+                        engine.setOption(option, value);
+                    }
+                };
+                auto barrier = std::make_shared<std::barrier<decltype(change)>>(slots.size(), change);
+                for (auto &slot : slots) {
+                    slot->submit([barrier]() { barrier->arrive_and_wait(); });
+                }
+                return;
+            }
+
+            std::shared_ptr<Session> &session = sessions[connection.get()][name];
+            if (!session) {
+                session = std::make_shared<Session>();
+                session->name = name;
+                session->connection = connection;
+                session->tag = nextTag();
+
+                // the slot with the fewest games gets the new one
+                auto slot = std::min_element(slots.begin(), slots.end(), [](const auto &a, const auto &b) {
+                    return a->games < b->games;
+                });
+                session->slot = slot->get();
+                session->slot->games++;
+            }
+
+            stream >> token;
+            if (token == "position") {
+                parsePosition(stream, *session);
+            }
+            else if (token == "go") {
+                if (session->busy) {
+                    session->send("info string already searching, send stop first");
+                    return;
+                }
+                session->busy = true;
+                session->stopRequested = false;
+
+                auto request = std::make_shared<SearchRequest>();
+                request->session = session;
+                request->fen = session->fen;
+                request->moves = session->moves;
+                request->tag = session->tag;
+                request->limits = parseGo(stream, *session);
+                Slot *slot = session->slot;
+                slot->submit([slot, request]() { slot->search(*request); });
+            }
+            else if (token == "stop") {
+                session->stopRequested = true;
+                session->slot->stop(session.get());
+            }
+            else if (token == "ucinewgame") {
+                // the old game's entries are left to age out of the hash, the histories of the slot are cleared
+                // once the searches queued before this are done
+                session->fen = "startpos";
+                session->moves.clear();
+                session->tag = nextTag();
+                session->slot->submit([slot = session->slot]() { slot->clearHistories(); });
+            }
+            else if (token == "isready") {
+                session->send("readyok");
+            }
+            else if (token == "stats") {
+                std::lock_guard<std::mutex> lock(session->metricsMutex);
+                int n = std::max(session->searches, 1);
+                std::stringstream out;
+                out << "info string searches " << session->searches
+                    << " queued avg " << session->queueTotal / n << " ms max " << session->queueMax << " ms"
+                    << " latency avg " << session->latencyTotal / n << " ms max " << session->latencyMax << " ms"
+                    << " late " << session->late;
+                session->send(out.str());
+            }
+            else if (token == "close") {
+                closeSession(*session);
+                sessions[connection.get()].erase(name);
+            }
+            else {
+                session->send("info string unknown command " + token);
+            }
+        }
+
+        Engine &engine;
+        std::vector<std::unique_ptr<Slot>> slots;
+        std::unordered_map<const Connection*, std::unordered_map<std::string, std::shared_ptr<Session>>> sessions;
+        bool quit = false;
+    };
+
+}
+
+namespace Server {
+
+    void run(const char* path, int slots, int threads) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof(address.sun_path)) {
+            std::cout << "info string the socket path " << path << " is too long" << std::endl;
+            return;
+        }
+        std::strcpy(address.sun_path, path);
+
+        // a socket left behind by a server that didn't shut down cleanly would keep us from binding
+        struct stat status{};
+        if (stat(path, &status) == 0 && S_ISSOCK(status.st_mode)) {
+            unlink(path);
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, (sockaddr*) &address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+            std::cout << "info string failed to listen on " << path << ": " << std::strerror(errno) << std::endl;
+            if (listener >= 0) {
+                close(listener);
+            }
+            return;
+        }
+
+        int wake[2];
+        if (pipe(wake) != 0) {
+            std::cout << "info string failed to make a pipe: " << std::strerror(errno) << std::endl;
+            close(listener);
+            return;
+        }
+        fcntl(wake[0], F_SETFL, fcntl(wake[0], F_GETFL) | O_NONBLOCK);
+        fcntl(wake[1], F_SETFL, fcntl(wake[1], F_GETFL) | O_NONBLOCK);
+        wakeFd = wake[1];
+
+        Engine engine;
+        Dispatcher server(engine, std::max(slots, 1), std::clamp(threads, 1, 1024));
+        std::vector<std::shared_ptr<Connection>> connections;
+        std::cout << "info string serving games on " << path << std::endl;
+
+        std::vector<pollfd> fds;
+        char buffer[4096];
+        while (!server.quit) {
+            fds.assign({pollfd{listener, POLLIN, 0}, pollfd{wake[0], POLLIN, 0}});
+            for (auto &connection : connections) {
+                fds.push_back(pollfd{connection->fd, short(POLLIN | (connection->pending() ? POLLOUT : 0)), 0});
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            if (fds[1].revents & POLLIN) {
+                while (read(wake[0], buffer, sizeof(buffer)) > 0) {}
+            }
+
+            // the new connections are added after this round, so fds still lines up with connections below
+            std::vector<std::shared_ptr<Connection>> accepted;
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd >= 0) {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    accepted.push_back(std::make_shared<Connection>(fd));
+                }
+            }
+
+            for (size_t i = 0; i < connections.size() && !server.quit; i++) {
+                short events = fds[i + 2].revents;
+                if (!events) {
+                    continue;
+                }
+
+                Connection &connection = *connections[i];
+                if (events & POLLOUT) {
+                    connection.flush();
+                }
+                if (!(events & (POLLIN | POLLHUP | POLLERR))) {
+                    continue;
+                }
+
+                ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> lock(connection.mutex);
+                    connection.closed = true;
+                    continue;
+                }
+
+                connection.input.append(buffer, size_t(n));
+                size_t start = 0, end;
+                while (!server.quit && (end = connection.input.find('\n', start)) != std::string::npos) {
+                    std::string line = connection.input.substr(start, end - start);
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    server.handle(connections[i], line);
+                    start = end + 1;
+                }
+                connection.input.erase(0, start);
+            }
+
+            // a connection can also be closed by a failed write, its socket closes once no search holds it
+            std::erase_if(connections, [&server](const std::shared_ptr<Connection> &connection) {
+                {
+                    std::lock_guard<std::mutex> lock(connection->mutex);
+                    if (!connection->closed) {
+                        return false;
+                    }
+                }
+                server.closeSessions(*connection);
+                return true;
+            });
+            connections.insert(connections.end(), accepted.begin(), accepted.end());
+        }
+
+        for (auto &connection : connections) {
+            server.closeSessions(*connection);
+        }
+        close(listener);
+        close(wake[0]);
+        close(wake[1]);
+        unlink(path);
+    }
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_SERVER_H
+#define ANDURIL_ENGINE_SERVER_H
+
+// plays many games from one process, so they all share the network, the lookup tables, the hash and the threads.
+//
+// clients connect to a UNIX socket and put the name of a game in front of every UCI command for it, a game is made
+// the first time its name shows up and belongs to that connection:
+//     game1 position startpos moves e2e4
+//     game1 go wtime 1000 btime 1000 winc 10 binc 10
+// and every answer comes back with the name in front:
+//     game1 bestmove e7e5 ponder g1f3
+// games understand position, go, stop, ucinewgame, isready, stats and close.  setoption and quit without a name
+// change an option for every game and shut the server down, Threads sets the threads of every slot.
+//
+// the threads are split into slots, each with its own pool and so its own histories.  A game stays on the slot
+// with the fewest games when it was made, and the slots search their games at the same time.  ucinewgame clears
+// the histories of the game's slot, so with more games than slots the games sharing a slot share them too.
+// A slot runs the searches of its games one at a time, the clock of a search starts when its go arrives so the time
+// spent waiting behind the other games of the slot is counted.  A search that waited past its hard limit only gets
+// the first depth, which only happens when a slot has more games on a short clock than it can keep up with.
+// searches without a clock, go infinite included, stop after 10 seconds so they can't hold a slot
+namespace Server {
+
+    // serves games on a socket at path until a client sends quit, with slots slots of threads threads each
+    void run(const char* path, int slots, int threads);
+
+}
+
+#endif //ANDURIL_ENGINE_SERVER_H
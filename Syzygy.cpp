@@ -2,42 +2,296 @@
 // Created by Kevin on 12/5/2024.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "Anduril.h"
+#include "misc.h"
 #include "Pyrrhic/tbprobe.h"
 #include "Syzygy.h"
+#include "Thread.h"
 
 // from tbprobe.cpp
 extern int TB_LARGEST;
 
 extern int syzygyProbeDepth;
+extern bool syzygy50MoveRule;
+extern int syzygyWarmupMB;
+
+extern ThreadPool gondor;
+
+// the rank Pyrrhic gives a win that is safe from the 50 move rule, TB_MAX_DTZ in tbprobe.cpp
+constexpr int TB_MAX_RANK = 0x40000;
+
+// moves ranked at least this high still win, with the 50 move rule the win has to come within its 100 plies
+static int winBound() {
+    return syzygy50MoveRule ? TB_MAX_RANK - 100 : 1;
+}
+
+// the WDL cache.  A slot holds the hash of the position with the result plus one in its low bits, so an empty slot is 0.
+// the threads read and write it without locking, a slot getting overwritten by another position only costs us a probe
+static std::unique_ptr<std::atomic<uint64_t>[]> wdlCache;
+static size_t cacheEntries = 0;
+
+constexpr uint64_t RESULT_MASK = 7;
+
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// the background thread reading the tables in.  It has to be stopped before the tables are freed,
+// and joined at exit since a joinable thread would terminate the program
+static struct Warmup {
+    std::thread thread;
+    std::atomic<bool> stop = false;
+
+    void finish() {
+        stop = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+        stop = false;
+    }
+
+    ~Warmup() { finish(); }
+} warmupThread;
+
+static bool warmupStopped() {
+    return warmupThread.stop.load(std::memory_order_relaxed);
+}
+
+// lets pyrrhic look for the table files on the pool threads
+static void poolFor(int count, void (*body)(int i, void *data), void *data) {
+    gondor.parallelFor(size_t(count), 16, [body, data](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            body(int(i), data);
+        }
+    });
+}
 
 namespace Tablebase{
 
-unsigned probeTablebaseWDL(libchess::Position& board, int depth, int ply) {
+void init(const char *path) {
+    warmupThread.finish();
+
+    tb_set_parallel_for(poolFor);
+    tb_free();
+    tb_init(path);
+    clearCache();
+
+    warmup();
+}
+
+void warmup() {
+    warmupThread.finish();
+    if (syzygyWarmupMB > 0 && TB_LARGEST > 0) {
+        size_t budget = size_t(syzygyWarmupMB) * 1024 * 1024;
+        warmupThread.thread = std::thread([budget]() { tb_warmup(budget, warmupStopped); });
+    }
+}
+
+void ProbeStats::record(Kind kind, uint64_t ns) {
+    histogram[kind][std::min<int>(BUCKETS - 1, std::bit_width(ns))]++;
+    count[kind]++;
+    totalNs[kind] += ns;
+}
+
+void ProbeStats::add(const ProbeStats &other) {
+    for (int k = 0; k < KINDS; k++) {
+        for (int b = 0; b < BUCKETS; b++) {
+            histogram[k][b] += other.histogram[k][b];
+        }
+        count[k] += other.count[k];
+        totalNs[k] += other.totalNs[k];
+    }
+}
+
+void resizeCache(size_t mb) {
+    cacheEntries = mb * 1024 * 1024 / sizeof(uint64_t);
+    wdlCache.reset(cacheEntries ? new std::atomic<uint64_t>[cacheEntries]() : nullptr);
+}
+
+void clearCache() {
+    for (size_t i = 0; i < cacheEntries; i++) {
+        wdlCache[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int cacheUsage() {
+    size_t sample = std::min<size_t>(1000, cacheEntries);
+    if (sample == 0) {
+        return 0;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        used += wdlCache[i].load(std::memory_order_relaxed) != 0;
+    }
+    return int(used * 1000 / sample);
+}
+
+void reportStats(const ProbeStats &stats) {
+    static const char *names[ProbeStats::KINDS] = {"cache hit", "warm page", "cold page"};
+
+    uint64_t probes = stats.probes();
+    std::cout << "info string tb probes " << probes << " cache hits " << stats.count[ProbeStats::CacheHit]
+              << " (" << (probes ? stats.count[ProbeStats::CacheHit] * 100 / probes : 0) << "%) cache full "
+              << cacheUsage() << " permille" << std::endl;
+
+    for (int k = 0; k < ProbeStats::KINDS; k++) {
+        uint64_t count = stats.count[k];
+        if (count == 0) {
+            continue;
+        }
+
+        // the percentiles can only be as precise as the buckets, so we give the upper edge of the bucket they fall in
+        uint64_t p50 = 0, p99 = 0, seen = 0;
+        for (int b = 0; b < ProbeStats::BUCKETS; b++) {
+            seen += stats.histogram[k][b];
+            if (!p50 && seen * 2 >= count) {
+                p50 = uint64_t(1) << b;
+            }
+            if (!p99 && seen * 100 >= count * 99) {
+                p99 = uint64_t(1) << b;
+                break;
+            }
+        }
+
+        std::cout << "info string tb " << names[k] << " " << count << " avg " << stats.totalNs[k] / count
+                  << " ns p50 <" << p50 << " ns p99 <" << p99 << " ns" << std::endl;
+    }
+}
+
+unsigned probeTablebaseWDL(libchess::Position& board, int depth, int ply, ProbeStats *stats) {
 
     // Do not probe at root, in nodes with castling rights, in nodes with 50 move rule risk, or nodes that have too many pieces
     if (ply == 0
         || board.castling_rights().value()
         || board.halfmoves()
-        || board.occupancy_bb().popcount() > TB_LARGEST) {
+        || board.piece_count() > TB_LARGEST) {
         return TB_RESULT_FAILED;
     }
 
     // do not probe if depth is lower than the probe depth unless the board has fewer pieces than the largest tablebase
-    if (depth < syzygyProbeDepth && board.occupancy_bb().popcount() == TB_LARGEST) {
+    if (depth < syzygyProbeDepth && board.piece_count() == TB_LARGEST) {
         return TB_RESULT_FAILED;
     }
 
-    // probe the tablebase using the pyrrhic api
-    return tb_probe_wdl(board.color_bb(libchess::constants::WHITE),
-                        board.color_bb(libchess::constants::BLACK),
-                        board.piece_type_bb(libchess::constants::KING),
-                        board.piece_type_bb(libchess::constants::QUEEN),
-                        board.piece_type_bb(libchess::constants::ROOK),
-                        board.piece_type_bb(libchess::constants::BISHOP),
-                        board.piece_type_bb(libchess::constants::KNIGHT),
-                        board.piece_type_bb(libchess::constants::PAWN),
-                        board.enpassant_square() ? board.enpassant_square().value() : 0,
-                        board.side_to_move() == libchess::constants::WHITE);
+    // reading the clock costs about as much as a cache hit, so it is only done when someone wants the numbers
+    std::chrono::steady_clock::time_point start;
+    if (stats) {
+        start = std::chrono::steady_clock::now();
+    }
+
+    // the result doesn't depend on anything the hash leaves out, castling and the 50 move counter were ruled out above
+    uint64_t hash = board.hash();
+    std::atomic<uint64_t> *slot = cacheEntries ? &wdlCache[mul_hi64(hash, cacheEntries)] : nullptr;
+    if (slot) {
+        uint64_t entry = slot->load(std::memory_order_relaxed);
+        if (entry && (entry & ~RESULT_MASK) == (hash & ~RESULT_MASK)) {
+            if (stats) {
+                stats->record(ProbeStats::CacheHit, nanosecondsSince(start));
+            }
+            return unsigned(entry & RESULT_MASK) - 1;
+        }
+    }
+
+    // probe the tablebase using the pyrrhic api.  If the thread took a page fault in there the tables weren't in memory
+    uint64_t faults = stats ? threadPageFaults() : 0;
+    unsigned result = tb_probe_wdl(board.color_bb(libchess::constants::WHITE),
+                                   board.color_bb(libchess::constants::BLACK),
+                                   board.piece_type_bb(libchess::constants::KING),
+                                   board.piece_type_bb(libchess::constants::QUEEN),
+                                   board.piece_type_bb(libchess::constants::ROOK),
+                                   board.piece_type_bb(libchess::constants::BISHOP),
+                                   board.piece_type_bb(libchess::constants::KNIGHT),
+                                   board.piece_type_bb(libchess::constants::PAWN),
+                                   board.enpassant_square() ? board.enpassant_square().value() : 0,
+                                   board.side_to_move() == libchess::constants::WHITE);
+    if (stats) {
+        stats->record(threadPageFaults() != faults ? ProbeStats::ColdPage : ProbeStats::WarmPage, nanosecondsSince(start));
+    }
+
+    if (slot && result != TB_RESULT_FAILED) {
+        slot->store((hash & ~RESULT_MASK) | (result + 1), std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+bool rankRootMoves(libchess::Position &board, std::vector<RootMove> &rootMoves, bool &dtzAvailable) {
+    dtzAvailable = false;
+
+    if (rootMoves.empty()
+        || board.castling_rights().value()
+        || board.piece_count() > TB_LARGEST) {
+        return false;
+    }
+
+    TbRootMoves results;
+    uint64_t white   = board.color_bb(libchess::constants::WHITE);
+    uint64_t black   = board.color_bb(libchess::constants::BLACK);
+    uint64_t kings   = board.piece_type_bb(libchess::constants::KING);
+    uint64_t queens  = board.piece_type_bb(libchess::constants::QUEEN);
+    uint64_t rooks   = board.piece_type_bb(libchess::constants::ROOK);
+    uint64_t bishops = board.piece_type_bb(libchess::constants::BISHOP);
+    uint64_t knights = board.piece_type_bb(libchess::constants::KNIGHT);
+    uint64_t pawns   = board.piece_type_bb(libchess::constants::PAWN);
+    unsigned ep = board.enpassant_square() ? board.enpassant_square().value() : 0;
+    bool turn = board.side_to_move() == libchess::constants::WHITE;
+
+    // DTZ lets us pick the moves that make progress, WDL can only tell us which ones keep the result
+    dtzAvailable = tb_probe_root_dtz(white, black, kings, queens, rooks, bishops, knights, pawns,
+                                     board.halfmoves(), ep, turn, board.has_repeated(), &results);
+    if (!dtzAvailable
+        && !tb_probe_root_wdl(white, black, kings, queens, rooks, bishops, knights, pawns,
+                              board.halfmoves(), ep, turn, syzygy50MoveRule, &results)) {
+        return false;
+    }
+
+    for (RootMove &rm : rootMoves) {
+        auto match = std::find_if(results.moves, results.moves + results.size, [&rm](const TbRootMove &m) {
+            // pyrrhic numbers the promotions queen, rook, bishop, knight starting at 1
+            int promotion = !rm.move.promotion_piece_type()                                ? 0
+                          : *rm.move.promotion_piece_type() == libchess::constants::QUEEN  ? PYRRHIC_FLAG_QPROMO
+                          : *rm.move.promotion_piece_type() == libchess::constants::ROOK   ? PYRRHIC_FLAG_RPROMO
+                          : *rm.move.promotion_piece_type() == libchess::constants::BISHOP ? PYRRHIC_FLAG_BPROMO
+                                                                                           : PYRRHIC_FLAG_NPROMO;
+            return PYRRHIC_MOVE_FROM(m.move) == unsigned(rm.move.from_square().value())
+                && PYRRHIC_MOVE_TO(m.move) == unsigned(rm.move.to_square().value())
+                && (PYRRHIC_MOVE_FLAGS(m.move) & PYRRHIC_MASK_PROMO_FLAGS) == unsigned(promotion);
+        });
+        if (match == results.moves + results.size) {
+            return false;
+        }
+        rm.tbRank = match->tbRank;
+    }
+
+    std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove &a, const RootMove &b) {
+        return a.tbRank > b.tbRank;
+    });
+
+    // every move that still wins is kept so the search can pick between them.
+    // otherwise only the moves that do as well as the best one are left
+    int best = rootMoves[0].tbRank;
+    int bound = winBound();
+    rootMoves.erase(std::remove_if(rootMoves.begin(), rootMoves.end(), [best, bound](const RootMove &rm) {
+        return best >= bound ? rm.tbRank < bound : rm.tbRank != best;
+    }), rootMoves.end());
+
+    return true;
+}
+
+int rootScore(const RootMove &rm) {
+    int bound = winBound();
+    return rm.tbRank >= bound  ?  31752
+         : rm.tbRank <= -bound ? -31752
+         : 0;
 }
 
 
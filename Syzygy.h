@@ -5,12 +5,64 @@
 #ifndef SYZYGY_H
 #define SYZYGY_H
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "libchess/Position.h"
 
+struct RootMove;
+
 namespace Tablebase {
 
-// Probe the Syzygy tablebases for a WDL value
-unsigned probeTablebaseWDL(libchess::Position &board, int depth, int ply);
+// loads the tables from a new path, looking for the files on the pool threads.  Starts the warmup if it is turned on
+void init(const char *path);
+
+// (re)starts reading the most used WDL tables in on a background thread, up to the SyzygyWarmup budget
+void warmup();
+
+// how long the WDL probes took, split by where the answer came from.  Each search thread keeps its own,
+// the main thread adds them up once the search is over
+struct ProbeStats {
+    // a cache hit never touches the tables, a warm page probe read the tables without taking a page fault,
+    // a cold page probe had to fault at least one page of the tables in
+    enum Kind { CacheHit, WarmPage, ColdPage, KINDS };
+
+    // bucket i counts the probes that took less than 2^i nanoseconds
+    static constexpr int BUCKETS = 32;
+
+    uint64_t histogram[KINDS][BUCKETS] = {};
+    uint64_t count[KINDS] = {};
+    uint64_t totalNs[KINDS] = {};
+
+    void record(Kind kind, uint64_t ns);
+    void add(const ProbeStats &other);
+    void clear() { *this = ProbeStats(); }
+    uint64_t probes() const { return count[CacheHit] + count[WarmPage] + count[ColdPage]; }
+};
+
+// Probe the Syzygy tablebases for a WDL value, going through the WDL cache first.  With stats the probe is timed and
+// its page faults counted, which costs two clock reads and two system calls, so the search leaves it out by default
+unsigned probeTablebaseWDL(libchess::Position &board, int depth, int ply, ProbeStats *stats = nullptr);
+
+// sets the size of the WDL cache in megabytes, 0 turns it off.  The cache is cleared
+void resizeCache(size_t mb);
+
+// forgets every cached result, needed whenever the tables themselves change
+void clearCache();
+
+// how full the WDL cache is in permille
+int cacheUsage();
+
+// sends the probe counts and latencies as info strings
+void reportStats(const ProbeStats &stats);
+
+// Rank the root moves with the DTZ tables, or the WDL tables if DTZ is missing, and drop every move that does worse
+// than the best one.  Returns false and leaves the moves alone if the root isn't in the tablebases
+bool rankRootMoves(libchess::Position &board, std::vector<RootMove> &rootMoves, bool &dtzAvailable);
+
+// score to show for a root move ranked by rankRootMoves
+int rootScore(const RootMove &rm);
 
 }
 
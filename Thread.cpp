@@ -2,19 +2,28 @@
 // Created by Hughe on 2/19/2024.
 //
 
+#include <unordered_map>
+
 #include "Thread.h"
 
-Thread::Thread(libchess::Position &b, int n) : ID(n),
+Thread::Thread(ThreadPool &p, libchess::Position &b, int n) : ID(n),
+                        engine(std::make_unique<Anduril>(n, p)),
+                        pool(p),
                         board(b),
-                        engine(std::make_unique<Anduril>(n)),
-                        thread(&Thread::idle, this){
-    waitForSearchFinish();
+                        generation(p.generation.load()),
+                        thread(n == 0 ? &Thread::idle : &Thread::park, this){
+    if (n == 0) {
+        waitForSearchFinish();
+    }
 }
 
 // destructor sets exit to true, then calls startSearch to wake up the thread
+// helpers have already been told to leave by the pool
 Thread::~Thread() {
-    exit = true;
-    startSearch();
+    if (ID == 0) {
+        exit = true;
+        startSearch();
+    }
     thread.join();
 }
 
@@ -26,6 +35,15 @@ void Thread::startSearch() {
     cv.notify_one();
 }
 
+// Wakes up the thread to run a job
+void Thread::startJob(std::function<void()> task) {
+    mutex.lock();
+    job = std::move(task);
+    searching = true;
+    mutex.unlock();
+    cv.notify_one();
+}
+
 // Blocks on condition variable until the thread is done searching
 void Thread::waitForSearchFinish() {
     std::unique_lock<std::mutex> lock(mutex);
@@ -47,45 +65,109 @@ void Thread::idle() {
 
         lock.unlock();
 
-        engine->go(board);
+        if (job) {
+            job();
+            job = nullptr;
+        }
+        else {
+            engine->go(board);
+        }
+
+    }
+
+}
+
+void Thread::park() {
+
+    while (true) {
+        generation = pool.awaitGeneration(generation);
+
+        if (pool.exiting) {
+            break;
+        }
+
+        if (pool.helperJob) {
+            pool.helperJob();
+        }
+        else {
+            engine->go(board);
+        }
 
+        pool.helperDone();
     }
 
 }
 
 ThreadPool::~ThreadPool() {
+    destroyThreads();
+}
+
+void ThreadPool::destroyThreads() {
     if (threads.size() > 0) {
         mainThread()->waitForSearchFinish();
+        waitForHelpers();
+
+        exiting = true;
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
 
         while (threads.size() > 0) {
             delete threads.back();
             threads.pop_back();
         }
 
+        exiting = false;
     }
 }
 
 // creates/destroys threads to match the requested number
 void ThreadPool::set(libchess::Position &b, int n) {
     // destroy existing threads
-    if (threads.size() > 0) {
-        mainThread()->waitForSearchFinish();
-
-        while (threads.size() > 0) {
-            delete threads.back();
-            threads.pop_back();
-        }
-    }
+    destroyThreads();
 
     if (n > 0) {
         while (threads.size() < n) {
-            threads.push_back(new Thread(b, threads.size()));
+            threads.push_back(new Thread(*this, b, threads.size()));
         }
 
         mainThread()->waitForSearchFinish();
     }
 }
 
+void ThreadPool::startHelpers() {
+    busyHelpers.store(int(threads.size()) - 1, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+}
+
+void ThreadPool::waitForHelpers() {
+    int busy;
+    for (int i = 0; i < SPIN_TRIES && busyHelpers.load(std::memory_order_acquire) != 0; i++) {
+        std::this_thread::yield();
+    }
+    while ((busy = busyHelpers.load(std::memory_order_acquire)) != 0) {
+        busyHelpers.wait(busy, std::memory_order_acquire);
+    }
+}
+
+uint32_t ThreadPool::awaitGeneration(uint32_t seen) {
+    for (int i = 0; i < SPIN_TRIES; i++) {
+        uint32_t current = generation.load(std::memory_order_acquire);
+        if (current != seen) {
+            return current;
+        }
+        std::this_thread::yield();
+    }
+    generation.wait(seen, std::memory_order_acquire);
+    return generation.load(std::memory_order_acquire);
+}
+
+void ThreadPool::helperDone() {
+    if (busyHelpers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        busyHelpers.notify_all();
+    }
+}
+
 // clears the search information from each thread
 void ThreadPool::clear() {
     for (Thread* t : threads) {
@@ -100,23 +182,148 @@ void ThreadPool::clear() {
 void ThreadPool::startSearch() {
     mainThread()->waitForSearchFinish();
     stop = false;
+    stopRequested = 0;
+    started = 0;
+    startedThreads = 0;
     mainThread()->startSearch();
 }
 
+void ThreadPool::requestStop(std::chrono::steady_clock::time_point when) {
+    std::chrono::steady_clock::rep expected = 0;
+    stopRequested.compare_exchange_strong(expected, when.time_since_epoch().count());
+    stop = true;
+}
+
+double ThreadPool::stopLatency() const {
+    std::chrono::steady_clock::rep requested = stopRequested.load();
+    if (requested == 0) {
+        return -1;
+    }
+    std::chrono::steady_clock::time_point when{std::chrono::steady_clock::duration(requested)};
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - when).count();
+}
+
 // wakes the non main threads
 void ThreadPool::wakeThreads() {
-    for (Thread* t : threads) {
-        if (t != threads.front()) {
-            t->startSearch();
-        }
+    if (threads.size() > 1) {
+        startHelpers();
     }
 }
 
 // waits for non-main threads to finish searching
 void ThreadPool::waitForSearchFinish() {
+    waitForHelpers();
+}
+
+void ThreadPool::markStarted() {
+    std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::chrono::steady_clock::rep last = started.load(std::memory_order_relaxed);
+    while (last < now && !started.compare_exchange_weak(last, now, std::memory_order_relaxed)) {}
+    startedThreads.fetch_add(1, std::memory_order_release);
+}
+
+std::chrono::steady_clock::time_point ThreadPool::lastStarted() const {
+    return std::chrono::steady_clock::time_point{std::chrono::steady_clock::duration(started.load())};
+}
+
+void ThreadPool::setNodeBudget(int64_t nodes) {
+    nodeBudget = nodes;
+}
+
+int64_t ThreadPool::takeNodes() {
+    // slices shrink as the budget runs out so that the threads holding unused nodes at the end can't add up to much
+    int64_t remaining = nodeBudget.load(std::memory_order_relaxed);
+    while (remaining > 0) {
+        int64_t slice = std::clamp<int64_t>(remaining / (4 * numThreads), 1, MAX_NODE_SLICE);
+        if (nodeBudget.compare_exchange_weak(remaining, remaining - slice, std::memory_order_relaxed)) {
+            return slice;
+        }
+    }
+    return 0;
+}
+
+uint64_t ThreadPool::sum(RelaxedCounter SearchStats::*counter) const {
+    uint64_t total = 0;
+    for (const Thread* t : threads) {
+        total += (t->engine->stats.*counter).load();
+    }
+    return total;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &body) {
+    std::atomic<size_t> next = 0;
+    chunk = std::max<size_t>(chunk, 1);
+
+    auto work = [&]() {
+        size_t begin;
+        while ((begin = next.fetch_add(chunk, std::memory_order_relaxed)) < count) {
+            body(begin, std::min(begin + chunk, count));
+        }
+    };
+
+    if (threads.empty()) {
+        work();
+        return;
+    }
+
+    mainThread()->waitForSearchFinish();
+    waitForHelpers();
+
+    helperJob = work;
+    mainThread()->startJob(work);
+    if (threads.size() > 1) {
+        startHelpers();
+    }
+
+    // the calling thread would only be waiting otherwise
+    work();
+
+    mainThread()->waitForSearchFinish();
+    waitForHelpers();
+    helperJob = nullptr;
+}
+
+// idea from Stockfish: every thread votes for its move, weighted by how deep it got and how much better its score is
+// than the worst one.  A proven win is taken over any vote, shortest first, and a proven loss never wins a vote
+Thread* ThreadPool::bestThread() const {
+    Thread* best = mainThread();
+    std::unordered_map<uint32_t, int64_t> votes;
+    int minScore = 32001;
+
+    for (const Thread* t : threads) {
+        if (t->engine->result.depth > 0) {
+            minScore = std::min(minScore, t->engine->result.score);
+        }
+    }
+
+    for (const Thread* t : threads) {
+        const SearchResult &r = t->engine->result;
+        if (r.depth > 0 && !r.pv.empty()) {
+            votes[r.pv[0].value()] += int64_t(r.score - minScore + 14) * r.depth;
+        }
+    }
+
     for (Thread* t : threads) {
-        if (t != threads.front()) {
-            t->waitForSearchFinish();
+        const SearchResult &r = t->engine->result;
+        const SearchResult &b = best->engine->result;
+        if (r.depth == 0 || r.pv.empty()) {
+            continue;
+        }
+        if (b.depth == 0 || b.pv.empty()) {
+            best = t;
+        }
+        else if (b.score >= 31000) {
+            if (r.score > b.score) {
+                best = t;
+            }
+        }
+        else if (r.score >= 31000
+                 || (r.score > -31000
+                     && (votes[r.pv[0].value()] > votes[b.pv[0].value()]
+                         || (votes[r.pv[0].value()] == votes[b.pv[0].value()] && r.depth > b.depth)))) {
+            best = t;
         }
     }
-}
\ No newline at end of file
+
+    return best;
+}
@@ -5,15 +5,22 @@
 #ifndef ANDURIL_ENGINE_THREAD_H
 #define ANDURIL_ENGINE_THREAD_H
 
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 
 #include "Anduril.h"
+#include "DeferTable.h"
 
+class ThreadPool;
+
+// the main thread is started by the UCI thread through its own mutex and condition variable.
+// helper threads all park on the pool's start barrier instead, so they can be woken and waited for at once
 class Thread {
 public:
-    Thread(libchess::Position &b, int n);
+    Thread(ThreadPool &p, libchess::Position &b, int n);
     virtual ~Thread();
 
     void idle();
@@ -21,15 +28,27 @@ public:
     void waitForSearchFinish();
     int id() const { return ID; }
 
+    // wakes the main thread to run a job instead of a search, waitForSearchFinish waits for it too
+    void startJob(std::function<void()> task);
+
     std::unique_ptr<Anduril> engine;
 
 private:
+    // helper threads wait here for the pool to start a new generation
+    void park();
+
     int ID;
     std::mutex mutex;
     std::condition_variable cv;
     bool exit = false, searching = true;
-    std::thread thread;
+    std::function<void()> job;
+    ThreadPool &pool;
     libchess::Position &board;
+
+    // the last generation of the start barrier this helper has run
+    uint32_t generation;
+
+    std::thread thread;
 };
 
 class ThreadPool {
@@ -44,9 +63,60 @@ public:
 
     Thread* mainThread() const { return threads.front(); }
 
+    // flags the search to stop and remembers when the reason to stop happened, the first request wins
+    void requestStop(std::chrono::steady_clock::time_point when = std::chrono::steady_clock::now());
+
+    // time between the first stop request of the search and now, or -1 if the search finished without one
+    double stopLatency() const;
+
+    // sets the total number of nodes the threads may search, -1 for no limit
+    void setNodeBudget(int64_t nodes);
+    bool nodeLimited() const { return nodeBudget.load(std::memory_order_relaxed) != -1; }
+
+    // takes a slice of the node budget for a thread, returns 0 once it is all gone
+    int64_t takeNodes();
+
+    // adds up one of the search counters over every thread
+    uint64_t sum(RelaxedCounter SearchStats::*counter) const;
+
+    // picks the thread whose result we play, weighing each thread's vote by its depth and score
+    Thread* bestThread() const;
+
+    // called by every thread as it enters go, lastStarted is when the last of them got there
+    void markStarted();
+    std::chrono::steady_clock::time_point lastStarted() const;
+
+    // how many threads have entered go this search
+    int threadsStarted() const { return startedThreads.load(std::memory_order_acquire); }
+
+    // runs body(begin, end) over chunks of [0, count) on every thread of the pool and the calling thread,
+    // returning once all of it is done.  The threads take chunks as they finish, so uneven chunks balance out.
+    // must not be called during a search
+    void parallelFor(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &body);
+
     std::atomic_bool stop;
+
+    // true while we search on the opponent's time, the clock is ignored until ponderhit
+    std::atomic_bool pondering = false;
     int numThreads = 1;
 
+    // the root moves given with go searchmoves, empty to search them all.  Only changed between searches
+    std::vector<libchess::Move> searchMoves;
+
+    // when set, the main thread hands these the info lines and the best move instead of printing them.
+    // they are called from the main search thread, and only changed between searches
+    std::function<void(const SearchReport&)> onInfo;
+    std::function<void(libchess::Move best, libchess::Move ponder)> onBestMove;
+
+    // moves the threads are searching right now, used to spread them over the tree when ABDADA is on
+    DeferTable searching;
+
+    // the tag is mixed into the index of every hash key this pool's threads look up, so pools searching different
+    // games mostly land in different clusters and can share the table.  The low 16 bits stay clear so the keys
+    // saved in the nodes still match.  Only changed between searches
+    void setHashTag(uint64_t t) { tag = t & ~uint64_t(0xFFFF); }
+    uint64_t hashTag() const { return tag; }
+
     // iterator functions
     auto cbegin() const { return threads.cbegin(); }
     auto cend() const { return threads.cend(); }
@@ -54,8 +124,46 @@ public:
     auto end() { return threads.end(); }
 
 private:
+    friend class Thread;
+
     std::vector<Thread*> threads;
 
+    // deletes every thread, the helpers are told to leave through the start barrier
+    void destroyThreads();
+
+    // start barrier for the helper threads.  Bumping the generation wakes every helper at once and busyHelpers
+    // counts down as they finish, the last one wakes whoever is waiting.  Both wait on the atomics (a futex on linux)
+    // after spinning for a moment, since the next search often starts right after the last one ended
+    std::atomic<uint32_t> generation = 0;
+    std::atomic<int> busyHelpers = 0;
+
+    // set before a generation is started: the helpers run the job instead of searching, or leave
+    std::function<void()> helperJob;
+    bool exiting = false;
+
+    // number of times to yield and look again before sleeping on the barrier
+    static constexpr int SPIN_TRIES = 64;
+
+    void startHelpers();
+    void waitForHelpers();
+    uint32_t awaitGeneration(uint32_t seen);
+    void helperDone();
+
+    // when the last thread entered go this search, in steady clock ticks
+    std::atomic<std::chrono::steady_clock::rep> started = 0;
+    std::atomic<int> startedThreads = 0;
+
+    // largest slice of the node budget a thread takes at once
+    static constexpr int64_t MAX_NODE_SLICE = 1024;
+
+    // nodes left to hand out for the current search, -1 when there is no node limit
+    std::atomic<int64_t> nodeBudget = -1;
+
+    uint64_t tag = 0;
+
+    // when the stop was requested, in steady clock ticks.  0 means nothing has asked us to stop
+    std::atomic<std::chrono::steady_clock::rep> stopRequested = 0;
+
 };
 
 
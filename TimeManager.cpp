@@ -0,0 +1,65 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#include <algorithm>
+
+#include "TimeManager.h"
+
+void TimeManager::init(Clock::time_point startTime, int time, int increment, int movesToGo, int moveTime, int overhead) {
+    start = startTime;
+    stability = 0;
+    lastBestMove = libchess::Move(0);
+    averageScore = 0;
+    iterations = 0;
+
+    // movetime is exact, we just leave room for the overhead
+    fixedTime = moveTime != -1;
+    if (fixedTime) {
+        hard = std::max(1, moveTime - overhead);
+        optimum = soft = double(hard);
+        return;
+    }
+
+    increment = std::max(increment, 0);
+    int mtg = movesToGo > 0 ? std::min(movesToGo, 50) : 35;
+
+    // the time we have for the rest of the moves until the next control, minus the overhead each of them costs.
+    // on a short clock that would be more than we have, so the overhead never takes more than a quarter of it
+    int64_t reserve = std::min<int64_t>(int64_t(overhead) * (mtg + 2), time / 4);
+    int64_t timeLeft = std::max<int64_t>(1, int64_t(time) + int64_t(increment) * (mtg - 1) - reserve);
+    optimum = double(timeLeft) / mtg;
+
+    // the hard limit allows for a few times the optimum but never gets close to flagging.  It keeps a small share
+    // of the clock even when the overhead eats the rest, or the search couldn't finish a single depth
+    int64_t maxTime = int64_t((time - overhead) * (mtg == 1 ? 0.9 : 0.75));
+    hard = std::max<int64_t>(std::max(1, time / 20), std::min(int64_t(optimum * 5), maxTime));
+    optimum = std::min(optimum, double(hard));
+    soft = optimum;
+}
+
+bool TimeManager::stopAfterIteration(libchess::Move bestMove, int score, double nodeFraction) {
+    if (fixedTime) {
+        return false;
+    }
+
+    // a best move that keeps changing needs more time, one that sticks around needs less
+    stability = bestMove == lastBestMove ? stability + 1 : 0;
+    lastBestMove = bestMove;
+    double stabilityFactor = 1.3 - 0.06 * std::min(stability, 10);
+
+    // spend more when the score is falling compared to the last few iterations
+    double trendFactor = iterations > 0 ? std::clamp(1.0 + (averageScore - score) * 0.004, 0.8, 1.5) : 1.0;
+    averageScore = iterations > 0 ? (averageScore * 2 + score) / 3 : score;
+    iterations++;
+
+    // if nearly all of the nodes went to the best move, nothing else is coming close
+    double nodeFactor = std::clamp(1.6 - nodeFraction, 0.6, 1.5);
+
+    soft = std::min(optimum * stabilityFactor * trendFactor * nodeFactor, double(hard));
+    return elapsed() >= soft;
+}
+
+double TimeManager::elapsed() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
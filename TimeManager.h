@@ -0,0 +1,57 @@
+//
+// Created by Krtoonbrat on 10/18/2026.
+//
+
+#ifndef ANDURIL_ENGINE_TIMEMANAGER_H
+#define ANDURIL_ENGINE_TIMEMANAGER_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "libchess/Move.h"
+
+// decides how long to think about a move
+// the hard limit is where the search gets aborted no matter what, the soft limit is checked after every iteration
+// and grows or shrinks with how settled the search looks
+class TimeManager {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // sets up the limits for a new search.  Times are in milliseconds for the side to move, -1 when not given
+    void init(Clock::time_point start, int time, int increment, int movesToGo, int moveTime, int overhead);
+
+    // the point at which the search has to stop
+    Clock::time_point hardDeadline() const { return start + std::chrono::milliseconds(hard); }
+
+    // called by the main thread after every completed iteration, returns true if we shouldn't start another one.
+    // nodeFraction is the share of the root nodes that went to the best move
+    bool stopAfterIteration(libchess::Move bestMove, int score, double nodeFraction);
+
+    // how long we have been thinking, the soft limit we ended up with and the hard limit
+    double elapsed() const;
+    double softLimit() const { return soft; }
+    int64_t hardLimit() const { return hard; }
+
+private:
+    Clock::time_point start;
+
+    // the time we would like to use on an ordinary move, and the most we are ever allowed to use
+    double optimum = 0;
+    int64_t hard = 0;
+
+    // the scaled optimum from the last iteration
+    double soft = 0;
+
+    // movetime searches always use all of their time
+    bool fixedTime = false;
+
+    // how many iterations in a row the best move has stayed the same
+    int stability = 0;
+    libchess::Move lastBestMove = libchess::Move(0);
+
+    // average of the scores from the previous iterations, used to notice the score dropping
+    double averageScore = 0;
+    int iterations = 0;
+};
+
+#endif //ANDURIL_ENGINE_TIMEMANAGER_H
@@ -2,9 +2,9 @@
 // Created by 80hugkev on 6/9/2022.
 //
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <thread>
 
 #include "Anduril.h"
 #include "misc.h"
@@ -30,7 +30,7 @@ void Node::save(uint64_t k, int s, int t, int d, uint16_t m, int ev, bool pv) {
         nodeScore = int16_t(s);
         nodeEval = int16_t(ev);
         nodeDepth = int8_t(d);
-        nodeTypeGenBound = uint8_t(table.generation8 | t | uint8_t(pv) << 2);
+        nodeTypeGenBound = uint8_t(table.generation8.load(std::memory_order_relaxed) | t | uint8_t(pv) << 2);
 
     }
 
@@ -63,39 +63,29 @@ void TranspositionTable::resize(size_t tSize) {
 }
 
 // based on the stockfish multithreaded implementation
+// the pool's threads are already waiting for work, so we hand them the clear instead of starting new ones
 void TranspositionTable::clear() {
-    std::vector<std::thread> threadPool;
-
-    for (size_t idx = 0; idx < size_t(gondor.numThreads); ++idx) {
-        threadPool.emplace_back([this, idx]() {
-
-            const size_t stride = size_t(clusterCount / gondor.numThreads),
-                         start  = size_t(stride * idx),
-                         len    = idx != size_t(gondor.numThreads) - 1 ?
-                                  stride : clusterCount - start;
-
-            Cluster c;
-            c.entry[0] = Node{-32001, -32001, -99, 0, 0, 0};
-            c.entry[1] = c.entry[2] = c.entry[0];
-            c.padding[0] = c.padding[1] = 0;
-
-            std::fill_n(&tPtr[start], len, c);
-        });
-    }
-
-    for (auto & t : threadPool) {
-        t.join();
-    }
+    Cluster c;
+    c.entry[0] = Node{-32001, -32001, -99, 0, 0, 0};
+    c.entry[1] = c.entry[2] = c.entry[0];
+    c.padding[0] = c.padding[1] = 0;
+
+    // a few chunks per thread so the ones that finish early can help the rest
+    size_t chunk = clusterCount / (size_t(std::max(gondor.numThreads, 1)) * 4) + 1;
+    gondor.parallelFor(clusterCount, chunk, [this, &c](size_t begin, size_t end) {
+        std::fill_n(&tPtr[begin], end - begin, c);
+    });
 }
 
 Node* TranspositionTable::probe(uint64_t key, bool &foundNode) {
     Node *entry = firstEntry(key);
     uint16_t k = (uint16_t)key;
+    uint8_t generation = generation8.load(std::memory_order_relaxed);
 
     for (int i = 0; i < 3; i++) {
         if (entry[i].key == k || entry[i].key == 0) {
             foundNode = entry[i].key == k;
-            entry[i].nodeTypeGenBound = uint8_t(generation8 | (entry[i].nodeTypeGenBound & (GEN_DELTA - 1)));
+            entry[i].nodeTypeGenBound = uint8_t(generation | (entry[i].nodeTypeGenBound & (GEN_DELTA - 1)));
             return &entry[i];
         }
     }
@@ -103,7 +93,7 @@ Node* TranspositionTable::probe(uint64_t key, bool &foundNode) {
     // find an entry to be replaced
     Node *replace = entry;
     for (int i = 1; i < 3; i++) {
-        if (replace->nodeDepth - ((GEN_CYCLE + generation8 - replace->nodeTypeGenBound) & GEN_MASK) > entry[i].nodeDepth - ((GEN_CYCLE + generation8 - entry[i].nodeTypeGenBound) & GEN_MASK)) {
+        if (replace->nodeDepth - ((GEN_CYCLE + generation - replace->nodeTypeGenBound) & GEN_MASK) > entry[i].nodeDepth - ((GEN_CYCLE + generation - entry[i].nodeTypeGenBound) & GEN_MASK)) {
             replace = &entry[i];
         }
     }
@@ -116,9 +106,10 @@ Node* TranspositionTable::probe(uint64_t key, bool &foundNode) {
 // returns an approximation of the hash occupancy
 int TranspositionTable::hashFull() {
     int count = 0;
+    uint8_t generation = generation8.load(std::memory_order_relaxed);
     for (int i = 0; i < 1000; i++) {
         for (int j = 0; j < 3; j++) {
-            count += tPtr[i].entry[j].nodeDepth && (tPtr[i].entry[j].nodeTypeGenBound & GEN_MASK) == generation8;
+            count += tPtr[i].entry[j].nodeDepth && (tPtr[i].entry[j].nodeTypeGenBound & GEN_MASK) == generation;
         }
     }
     return count / 3;
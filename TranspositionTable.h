@@ -5,6 +5,8 @@
 #ifndef ANDURIL_ENGINE_TRANSPOSITIONTABLE_H
 #define ANDURIL_ENGINE_TRANSPOSITIONTABLE_H
 
+#include <atomic>
+
 #include "Node.h"
 
 // one cluster holds three nodes
@@ -42,7 +44,8 @@ class TranspositionTable {
 public:
     ~TranspositionTable();
 
-    void newSearch() { generation8 += GEN_DELTA; }
+    // several pools can start searches on the same table at once
+    void newSearch() { generation8.fetch_add(GEN_DELTA, std::memory_order_relaxed); }
 
     void resize(size_t tSize);
 
@@ -58,7 +61,7 @@ public:
 
     size_t sizeMB = 0;
 
-    uint8_t generation8 = 0;
+    std::atomic<uint8_t> generation8 = 0;
 
 private:
     Cluster *tPtr = nullptr;
@@ -2,20 +2,38 @@
 // Created by 80hugkev on 7/6/2022.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <string>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "Anduril.h"
+#include "BookMaker.h"
+#include "Engine.h"
 #include "misc.h"
 #include "libchess/Position.h"
+#include "Output.h"
 #include "Pyrrhic/tbprobe.h"
+#include "Server.h"
+#include "Syzygy.h"
 #include "Thread.h"
 #include "UCI.h"
 
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 int libchess::Position::pieceValuesMG[6] = {117, 439, 478, 659, 1455, 0};
 int libchess::Position::pieceValuesEG[6] = {149, 468, 514, 934, 1827, 0};
 int Anduril::pieceValues[16] = { 149,  468,  514,  934,  1827, 0, 0, 0,
@@ -39,13 +57,51 @@ namespace NNUE {
     extern char nnue_path[256];
 }
 
+std::string bookFiles = R"(..\book\Performance.bin)";
+
 char syzygy_path[256] = "<empty>";
 int syzygyProbeDepth = 1;
 bool syzygy50MoveRule = true;
 int syzygyProbeLimit = 7;
 
+// size of the WDL probe cache in megabytes, 0 turns it off
+int syzygyCacheMB = 16;
+
+// megabytes of WDL tables we read in ahead of time after loading them, 0 turns it off
+int syzygyWarmupMB = 0;
+
+// times every tablebase probe of the search, debug mode does too
+bool syzygyStats = false;
+
+// tablebase probe latencies of every search since we started, sent by the tbstats command.  The server's pools
+// can finish searches at the same time, so adding to it takes the mutex
+Tablebase::ProbeStats tbTotals;
+std::mutex tbTotalsMutex;
+
 ThreadPool gondor;
 
+// how much time we searched on the opponent's clock for moves we guessed right this game
+double ponderGained = 0;
+int ponderHits = 0;
+
+// number of best lines we search and report
+int multiPV = 1;
+
+// time in milliseconds we lose on every move to communication with the GUI
+int moveOverhead = 50;
+
+// set by the debug command, turns on extra info strings
+bool debugMode = false;
+
+// node limited searches only use the main thread, so the same position and hash give the same result every time
+bool deterministicNodes = false;
+
+// helper threads put off moves another thread is already searching
+bool abdada = false;
+
+// iterations finishing faster than this after the last info line are held back, only the newest gets sent
+constexpr int INFO_INTERVAL_MS = 10;
+
 namespace UCI {
 
     // FEN for the start position
@@ -57,14 +113,14 @@ namespace UCI {
 
         // set up the board, engine, book, and game state
         libchess::Position board(StartFEN);
-        Book openingBook = Book(R"(..\book\Performance.bin)");
+        Book openingBook = Book(bookFiles.c_str());
         openingBook.closeBook();
         bool bookOpen = openingBook.getBookOpen();
         gondor.set(board, 1);
 
         // initialize tablebase
-        tb_free();
-        tb_init(syzygy_path);
+        Tablebase::init(syzygy_path);
+        Tablebase::resizeCache(syzygyCacheMB);
 
         // load the nnue file
         NNUE::LoadNNUE();
@@ -78,12 +134,50 @@ namespace UCI {
                 gondor.mainThread()->engine->bench(board);
                 return;
             }
+            // times how long fresh processes take to answer uci, optionally followed by the number of launches
+            if (in == "startup-bench") {
+                startupBench(argv[0], argc > 2 ? std::stoi(argv[2]) : 20);
+                return;
+            }
+            // times starting and stopping the search threads, optionally followed by the thread count and runs
+            if (in == "thread-bench") {
+                threadBench(board, argc > 2 ? std::stoi(argv[2]) : int(std::max(1u, std::thread::hardware_concurrency())),
+                            argc > 3 ? std::stoi(argv[3]) : 50);
+                return;
+            }
+            // times short searches through the in-process api against the same searches over UCI, optionally followed
+            // by the number of searches and their depth
+            if (in == "api-bench") {
+                apiBench(argv[0], argc > 2 ? std::stoi(argv[2]) : 200, argc > 3 ? std::stoi(argv[3]) : 4);
+                return;
+            }
+            // hosts many games over a UNIX socket, followed by the socket path and optionally the number of slots and
+            // the threads of each slot
+            if (in == "server" && argc > 2) {
+                Server::run(argv[2], argc > 3 ? std::stoi(argv[3]) : int(std::max(1u, std::thread::hardware_concurrency())),
+                            argc > 4 ? std::stoi(argv[4]) : 1);
+                return;
+            }
+            // times threads probing the same cold endgame together, followed by the tablebase path and optionally the
+            // thread count and runs
+            if (in == "tb-bench" && argc > 2) {
+                tbBench(argv[2], argc > 3 ? std::stoi(argv[3]) : int(std::max(1u, std::thread::hardware_concurrency())),
+                        argc > 4 ? std::stoi(argv[4]) : 20);
+                return;
+            }
         }
 
-        while (true) {
+        // any other arguments are run as a single command, then we exit
+        std::string args;
+        for (int i = 1; i < argc; i++) {
+            args += std::string(argv[i]) + " ";
+        }
+
+        do {
             // grab the line
             // continue if we don't receive anything
-            if (!std::getline(std::cin, line)) { continue; }
+            if (argc > 1) { line = args; }
+            else if (!std::getline(std::cin, line)) { continue; }
 
             // continue if all we get is a new line
             if (line == "\n") { continue; }
@@ -103,9 +197,15 @@ namespace UCI {
                 parsePosition(stream, board);
             }
             else if (token == "setoption") {
-                parseOption(stream, board, bookOpen);
+                parseOption(stream, board, openingBook, bookOpen);
             }
             else if (token == "ucinewgame") {
+                if (debugMode && ponderHits > 0) {
+                    std::cout << "info string pondering gained " << ponderGained << " ms of search over " << ponderHits
+                              << " ponderhits last game" << std::endl;
+                }
+                ponderGained = 0;
+                ponderHits = 0;
                 if (!openingBook.getBookOpen()) { openingBook.flipBookOpen(); }
                 table.clear();
                 gondor.clear();
@@ -119,13 +219,41 @@ namespace UCI {
                 stream >> d;
                 gondor.mainThread()->engine->perft(board, d);
             }
+            else if (token == "tbstats") {
+                if (!syzygyStats && !debugMode) {
+                    std::cout << "info string probes are only timed with SyzygyStats or debug on" << std::endl;
+                }
+                Tablebase::reportStats(tbTotals);
+            }
+            else if (token == "makebook") {
+                parseMakeBook(stream);
+            }
             else if (token == "stop") {
-                gondor.stop = true;
+                gondor.requestStop();
+            }
+            else if (token == "ponderhit") {
+                // the opponent played the move we were pondering on, the time we already spent is free
+                if (gondor.pondering) {
+                    auto now = std::chrono::steady_clock::now();
+                    std::chrono::duration<double, std::milli> gained = now - gondor.mainThread()->engine->startTime;
+                    ponderGained += gained.count();
+                    ponderHits++;
+
+                    // if we pondered past the hard limit there is no reason to keep going
+                    gondor.pondering = false;
+                    if (gondor.mainThread()->engine->limits.timeSet && now >= gondor.mainThread()->engine->stopTime) {
+                        gondor.requestStop(now);
+                    }
+                }
             }
             else if (token == "quit") {
-                gondor.stop = true;
+                gondor.requestStop();
                 break;
             }
+            else if (token == "debug") {
+                stream >> token;
+                debugMode = token == "on";
+            }
             else if (token == "uci") {
                 std::cout << "id name Anduril" << std::endl;
                 std::cout << "id author Krtoonbrat" << std::endl;
@@ -133,7 +261,13 @@ namespace UCI {
                 std::cout << "option name ClearHash type button" << std::endl;
                 std::cout << "option name Threads type spin default 1 min 1 max 64" << std::endl;
                 std::cout << "option name Hash type spin default 256 min 16 max 33554432" << std::endl;
+                std::cout << "option name MoveOverhead type spin default 50 min 0 max 5000" << std::endl;
+                std::cout << "option name DeterministicNodes type check default false" << std::endl;
+                std::cout << "option name ABDADA type check default false" << std::endl;
+                std::cout << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
+                std::cout << "option name Ponder type check default false" << std::endl;
                 std::cout << "option name OwnBook type check default false" << std::endl;
+                std::cout << "option name BookFile type string default " << bookFiles << std::endl;
 
                 std::cout << "option name nnue_path type string default " << NNUE::nnue_path << std::endl;
 
@@ -141,6 +275,9 @@ namespace UCI {
                 std::cout << "option name SyzygyProbeDepth type spin default 1 min 1 max 100" << std::endl;
                 std::cout << "option name Syzygy50MoveRule type check default true" << std::endl;
                 std::cout << "option name SyzygyProbeLimit type spin default 7 min 0 max 7" << std::endl;
+                std::cout << "option name SyzygyCache type spin default 16 min 0 max 4096" << std::endl;
+                std::cout << "option name SyzygyWarmup type spin default 0 min 0 max 262144" << std::endl;
+                std::cout << "option name SyzygyStats type check default false" << std::endl;
 
                 std::cout << "option name bonusMult type string default " << bonusMult << std::endl;
                 std::cout << "option name bonusSub type string default " << bonusSub << std::endl;
@@ -156,10 +293,330 @@ namespace UCI {
 
 
             }
+        } while (argc == 1);
+
+        // the search threads copy the board when they start, so it has to outlive any search we started
+        gondor.mainThread()->waitForSearchFinish();
+    }
+
+    void startupBench(const char* self, int runs) {
+        // the engine is launched with uci as an argument so it answers without us having to write to its stdin
+        std::string command = std::string("\"") + self + "\" uci";
+#ifdef _WIN32
+        // cmd strips the outer quotes, so we need an extra set to keep the ones around the path
+        command = "\"" + command + "\"";
+#endif
+
+        std::vector<double> times;
+        for (int i = 0; i < runs; i++) {
+            auto start = std::chrono::steady_clock::now();
+            FILE* engine = popen(command.c_str(), "r");
+            if (!engine) {
+                std::cout << "info string failed to launch " << self << std::endl;
+                return;
+            }
+
+            char buffer[256];
+            bool answered = false;
+            while (std::fgets(buffer, sizeof(buffer), engine)) {
+                if (std::strncmp(buffer, "uciok", 5) == 0) {
+                    answered = true;
+                    break;
+                }
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            pclose(engine);
+
+            if (!answered) {
+                std::cout << "info string " << self << " never sent uciok" << std::endl;
+                return;
+            }
+            times.push_back(elapsed.count());
+        }
+
+        if (times.empty()) {
+            return;
+        }
+
+        std::sort(times.begin(), times.end());
+        std::cout << "startup to uciok over " << times.size() << " runs: min " << times.front()
+                  << " ms median " << times[times.size() / 2] << " ms max " << times.back() << " ms" << std::endl;
+    }
+
+    void threadBench(libchess::Position &board, int threads, int runs) {
+        // the info lines go straight to std::cout from here on, so silencing it below keeps the searches quiet
+        Output::stop();
+
+        gondor.numThreads = std::clamp(threads, 1, 1024);
+        gondor.set(board, gondor.numThreads);
+        Anduril *engine = gondor.mainThread()->engine.get();
+
+        std::vector<double> starts, stops;
+        std::streambuf *out = std::cout.rdbuf();
+        for (int i = 0; i < runs; i++) {
+            engine->limits.depth = 100;
+            engine->limits.nodes = -1;
+            engine->limits.timeSet = false;
+            gondor.setNodeBudget(-1);
+            gondor.searchMoves.clear();
+            gondor.pondering = false;
+
+            // the searches would flood the output, so it goes nowhere until we are done
+            std::cout.rdbuf(nullptr);
+
+            auto start = std::chrono::steady_clock::now();
+            engine->startTime = start;
+            table.newSearch();
+            gondor.startSearch();
+
+            // wait until every thread is in, a thread that never shows up within a second is a bug worth reporting
+            bool allStarted = true;
+            while (gondor.threadsStarted() < gondor.numThreads) {
+                if (std::chrono::steady_clock::now() - start > std::chrono::seconds(1)) {
+                    allStarted = false;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            std::chrono::duration<double, std::milli> started = gondor.lastStarted() - start;
+
+            auto stop = std::chrono::steady_clock::now();
+            gondor.requestStop(stop);
+            gondor.mainThread()->waitForSearchFinish();
+            std::chrono::duration<double, std::milli> stopped = std::chrono::steady_clock::now() - stop;
+
+            std::cout.rdbuf(out);
+            std::cout.clear();
+
+            if (!allStarted) {
+                std::cout << "info string only " << gondor.threadsStarted() << " of " << gondor.numThreads
+                          << " threads started within a second" << std::endl;
+            }
+
+            starts.push_back(started.count());
+            stops.push_back(stopped.count());
+        }
+
+        if (starts.empty()) {
+            return;
+        }
+
+        std::sort(starts.begin(), starts.end());
+        std::sort(stops.begin(), stops.end());
+        std::cout << gondor.numThreads << " threads over " << runs << " runs" << std::endl;
+        std::cout << "go to all threads searching: min " << starts.front() << " ms median " << starts[starts.size() / 2]
+                  << " ms max " << starts.back() << " ms" << std::endl;
+        std::cout << "stop to bestmove: min " << stops.front() << " ms median " << stops[stops.size() / 2]
+                  << " ms max " << stops.back() << " ms" << std::endl;
+    }
+
+    void tbBench(const char* path, int threads, int runs) {
+        constexpr int PROBES = 10000;
+        threads = std::clamp(threads, 1, 1024);
+
+        // the cache would answer every probe after the first one, we want to see the tables themselves
+        Tablebase::resizeCache(0);
+
+        std::vector<double> firsts, rest;
+        unsigned wdl = TB_RESULT_FAILED;
+        const char *fen = nullptr;
+        for (int i = 0; i < runs; i++) {
+            // loading the tables again leaves every one of them unmapped
+            Tablebase::init(path);
+            if (TB_LARGEST < 3) {
+                std::cout << "no tablebases found at " << path << std::endl;
+                return;
+            }
+            fen = TB_LARGEST >= 5 ? "7r/8/4k3/8/2R5/3P4/8/3K4 w - - 0 1" : "8/8/4k3/8/8/3P4/8/3K4 w - - 0 1";
+
+            std::atomic<bool> go = false;
+            std::vector<double> first(threads), after(threads);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&, t]() {
+                    libchess::Position board = *libchess::Position::from_fen(fen);
+                    Tablebase::ProbeStats stats;
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+
+                    auto start = std::chrono::steady_clock::now();
+                    unsigned result = Tablebase::probeTablebaseWDL(board, 100, 1, &stats);
+                    auto mapped = std::chrono::steady_clock::now();
+                    for (int p = 0; p < PROBES; p++) {
+                        Tablebase::probeTablebaseWDL(board, 100, 1, &stats);
+                    }
+                    auto end = std::chrono::steady_clock::now();
+
+                    first[t] = std::chrono::duration<double, std::micro>(mapped - start).count();
+                    after[t] = std::chrono::duration<double, std::nano>(end - mapped).count() / PROBES;
+                    if (t == 0) {
+                        wdl = result;
+                    }
+                });
+            }
+
+            go.store(true, std::memory_order_release);
+            for (auto &worker : workers) {
+                worker.join();
+            }
+
+            firsts.insert(firsts.end(), first.begin(), first.end());
+            rest.insert(rest.end(), after.begin(), after.end());
+        }
+
+        if (firsts.empty()) {
+            return;
+        }
+
+        std::sort(firsts.begin(), firsts.end());
+        std::sort(rest.begin(), rest.end());
+        std::cout << threads << " threads over " << runs << " runs probing " << fen << std::endl;
+        if (wdl == TB_RESULT_FAILED) {
+            std::cout << "the probe failed, the table for this position is missing or unreadable" << std::endl;
+            return;
+        }
+        std::cout << "first probe: min " << firsts.front() << " us median " << firsts[firsts.size() / 2]
+                  << " us max " << firsts.back() << " us" << std::endl;
+        std::cout << "probes after it: min " << rest.front() << " ns median " << rest[rest.size() / 2]
+                  << " ns max " << rest.back() << " ns" << std::endl;
+    }
+
+    void apiBench(const char* self, int requests, int depth) {
+        // positions from different stages of the game, so the searches aren't all alike
+        const char* fens[] = {StartFEN,
+                              "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+                              "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                              "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"};
+        constexpr int FENS = sizeof(fens) / sizeof(fens[0]);
+        requests = std::max(requests, 1);
+
+        std::chrono::duration<double> inProcess{};
+        {
+            Engine engine;
+            Engine::Limits limits;
+            limits.depth = depth;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < requests; i++) {
+                engine.setPosition(fens[i % FENS]);
+                engine.search(limits, [](const SearchReport&) {}, [](libchess::Move, libchess::Move) {});
+                engine.wait();
+            }
+            inProcess = std::chrono::steady_clock::now() - start;
+        }
+
+        std::cout << requests << " searches to depth " << depth << std::endl;
+        std::cout << "in process: " << requests / inProcess.count() << " requests/s, "
+                  << inProcess.count() * 1e6 / requests << " us each" << std::endl;
+
+#ifdef _WIN32
+        std::cout << "the UCI half of the benchmark needs POSIX pipes and is skipped here" << std::endl;
+#else
+        // a copy of the engine reading commands from one pipe and answering on the other, like it would under a GUI
+        int toEngine[2], fromEngine[2];
+        if (pipe(toEngine) != 0 || pipe(fromEngine) != 0) {
+            std::cout << "info string failed to make pipes for " << self << std::endl;
+            return;
+        }
+
+        pid_t child = fork();
+        if (child == 0) {
+            dup2(toEngine[0], STDIN_FILENO);
+            dup2(fromEngine[1], STDOUT_FILENO);
+            close(toEngine[0]);
+            close(toEngine[1]);
+            close(fromEngine[0]);
+            close(fromEngine[1]);
+            execl(self, self, (char*) nullptr);
+            _exit(127);
+        }
+        close(toEngine[0]);
+        close(fromEngine[1]);
+        if (child < 0) {
+            close(toEngine[1]);
+            close(fromEngine[0]);
+            std::cout << "info string failed to launch " << self << std::endl;
+            return;
+        }
+
+        FILE* commands = fdopen(toEngine[1], "w");
+        FILE* answers = fdopen(fromEngine[0], "r");
+        auto readUntil = [answers](const char* prefix) {
+            char buffer[4096];
+            while (std::fgets(buffer, sizeof(buffer), answers)) {
+                if (std::strncmp(buffer, prefix, std::strlen(prefix)) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        // starting the engine isn't part of what we measure
+        std::fputs("uci\nisready\n", commands);
+        std::fflush(commands);
+        bool answered = readUntil("readyok");
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; answered && i < requests; i++) {
+            std::fprintf(commands, "position fen %s\ngo depth %d\n", fens[i % FENS], depth);
+            std::fflush(commands);
+            answered = readUntil("bestmove");
+        }
+        std::chrono::duration<double> overPipes = std::chrono::steady_clock::now() - start;
+
+        std::fputs("quit\n", commands);
+        std::fclose(commands);
+        std::fclose(answers);
+        waitpid(child, nullptr, 0);
+
+        if (!answered) {
+            std::cout << "info string " << self << " stopped answering" << std::endl;
+            return;
+        }
+        std::cout << "over UCI pipes: " << requests / overPipes.count() << " requests/s, "
+                  << overPipes.count() * 1e6 / requests << " us each" << std::endl;
+#endif
+    }
+
+    void parseMakeBook(std::stringstream &stream) {
+        // format:
+        // makebook input games.pgn output book.bin plies 30 threads 8 memory 1024 mingames 2
+        std::string token, input, output;
+        int plies = 30, threads = int(std::max(1u, std::thread::hardware_concurrency())), minGames = 1;
+        size_t memory = 1024;
+
+        while (stream >> token) {
+            if (token == "input") {
+                stream >> input;
+            }
+            else if (token == "output") {
+                stream >> output;
+            }
+            else if (token == "plies") {
+                stream >> plies;
+            }
+            else if (token == "threads") {
+                stream >> threads;
+            }
+            else if (token == "memory") {
+                stream >> memory;
+            }
+            else if (token == "mingames") {
+                stream >> minGames;
+            }
+        }
+
+        if (input.empty() || output.empty()) {
+            std::cout << "info string makebook needs an input and an output file" << std::endl;
+            return;
         }
+
+        BookMaker maker(threads, plies, minGames, memory);
+        maker.make(input, output);
     }
 
-    void parseOption(std::stringstream &stream, libchess::Position &board, bool &bookOpen) {
+    void parseOption(std::stringstream &stream, libchess::Position &board, Book &openingBook, bool &bookOpen) {
         // format:
         // setoption name pMG value 100
 
@@ -203,6 +660,28 @@ namespace UCI {
             }
         }
 
+        else if (token == "MultiPV") {
+            stream >> multiPV;
+            multiPV = std::clamp(multiPV, 1, 256);
+        }
+
+        else if (token == "MoveOverhead") {
+            stream >> moveOverhead;
+            moveOverhead = std::clamp(moveOverhead, 0, 5000);
+        }
+
+        // only search with the main thread under a node limit
+        else if (token == "DeterministicNodes") {
+            stream >> token;
+            deterministicNodes = token == "true";
+        }
+
+        // defer moves that another thread is searching
+        else if (token == "ABDADA") {
+            stream >> token;
+            abdada = token == "true";
+        }
+
         // set book open or closed
         else if (token == "OwnBook") {
             stream >> token;
@@ -214,6 +693,14 @@ namespace UCI {
             }
         }
 
+        // set the books, multiple books are separated by ';' and probed in that order
+        else if (token == "BookFile") {
+            std::getline(stream >> std::ws, bookFiles);
+            if (!openingBook.readBook(bookFiles.c_str())) {
+                std::cout << "info string no book could be opened from " << bookFiles << std::endl;
+            }
+        }
+
         // set nnue path
         else if (token == "nnue_path") {
             stream >> NNUE::nnue_path;
@@ -230,8 +717,7 @@ namespace UCI {
             if (end) {
                 *end = '\0';
             }
-            tb_free();
-            tb_init(syzygy_path);
+            Tablebase::init(syzygy_path);
 
             // give them some info
             if (TB_LARGEST != 0) {
@@ -259,6 +745,24 @@ namespace UCI {
             stream >> syzygyProbeLimit;
         }
 
+        else if (token == "SyzygyCache") {
+            stream >> syzygyCacheMB;
+            syzygyCacheMB = std::clamp(syzygyCacheMB, 0, 4096);
+            Tablebase::resizeCache(syzygyCacheMB);
+        }
+
+        // time the tablebase probes for the tbstats command
+        else if (token == "SyzygyStats") {
+            stream >> token;
+            syzygyStats = token == "true";
+        }
+
+        else if (token == "SyzygyWarmup") {
+            stream >> syzygyWarmupMB;
+            syzygyWarmupMB = std::clamp(syzygyWarmupMB, 0, 262144);
+            Tablebase::warmup();
+        }
+
         // set bonusMult
         else if (token == "bonusMult") {
             stream >> bonusMult;
@@ -302,109 +806,162 @@ namespace UCI {
     }
 
     void parseGo(std::stringstream &stream, libchess::Position &board, Book &openingBook, bool &bookOpen) {
-        // reset all the limit
-        int depth = -1; int moveTime = -1; int mtg = 35;
-        int time = -1;
-        int increment = 0;
-        int nodes = -1;
-        gondor.mainThread()->engine->limits.timeSet = false;
-
-        std::string token;
-
         // start the clock as early as possible to help avoid time loss on with extremely low clock
-        gondor.mainThread()->engine->startTime = std::chrono::steady_clock::now();
+        GoLimits limits;
+        bool readingMoves = false;
 
-        // this makes sure that the opening book is set to the correct state
-        if (!bookOpen) {
-            openingBook.closeBook();
-        }
+        std::string token;
 
         // consume the tokens
         while (stream >> token) {
+            // searchmoves is followed by moves until the next keyword, and no keyword parses as a move
+            if (readingMoves) {
+                std::optional<libchess::Move> move = libchess::Move::from(token);
+                if (move) {
+                    limits.searchMoves.push_back(*move);
+                    continue;
+                }
+                readingMoves = false;
+            }
+
             // commands
-            if (token == "infinite") {
-                openingBook.closeBook();
+            if (token == "searchmoves") {
+                readingMoves = true;
+            }
+
+            else if (token == "infinite") {
+                limits.infinite = true;
+            }
+
+            // we search the position after the move we expect, and keep going until ponderhit or stop
+            else if (token == "ponder") {
+                limits.ponder = true;
             }
 
             else if (token == "btime" && board.side_to_move()) {
-                stream >> time;
+                stream >> limits.time;
             }
 
             else if (token ==  "wtime" && !board.side_to_move()) {
-                stream >> time;
+                stream >> limits.time;
             }
 
             else if (token == "binc" && board.side_to_move()) {
-                stream >> increment;
+                stream >> limits.increment;
             }
 
             else if (token == "winc" && !board.side_to_move()) {
-                stream >> increment;
+                stream >> limits.increment;
             }
 
             else if (token == "movestogo") {
-                stream >> mtg;
+                stream >> limits.movesToGo;
             }
 
             else if (token == "movetime") {
-                stream >> moveTime;
+                stream >> limits.moveTime;
             }
 
             else if (token == "depth") {
-                stream >> depth;
+                stream >> limits.depth;
             }
 
             else if (token == "nodes") {
-                stream >> nodes;
+                stream >> limits.nodes;
             }
         }
 
-        if (moveTime != -1) {
-            time = moveTime;
-            mtg = 1;
+        startSearch(limits, board, openingBook, bookOpen, gondor);
+    }
+
+    void startSearch(const GoLimits &limits, libchess::Position &board, Book &openingBook, bool &bookOpen,
+                     ThreadPool &pool) {
+        Anduril *engine = pool.mainThread()->engine.get();
+        engine->startTime = limits.start;
+        engine->limits.timeSet = false;
+        pool.searchMoves = limits.searchMoves;
+
+        // this makes sure that the opening book is set to the correct state
+        if (!bookOpen || limits.infinite) {
+            openingBook.closeBook();
         }
 
-        gondor.mainThread()->engine->limits.depth = depth;
+        engine->limits.depth = limits.depth;
 
-        // nodes will really only work if we are searching with one thread
-        // the engine will most likely search a few more nodes than this if we are using multiple threads
-        gondor.mainThread()->engine->limits.nodes = nodes;
+        // every thread takes its nodes from one shared budget, so this holds at any thread count
+        engine->limits.nodes = limits.nodes;
+        pool.setNodeBudget(limits.nodes);
 
-        if (time != -1) {
-            gondor.mainThread()->engine->limits.timeSet = true;
-            time /= mtg;
-            time -= 50 * (moveTime == -1);
-            std::chrono::milliseconds searchTime(time + increment);
-            gondor.mainThread()->engine->stopTime = std::chrono::steady_clock::now();
-            gondor.mainThread()->engine->stopTime += searchTime;
+        if (limits.time != -1 || limits.moveTime != -1) {
+            engine->limits.timeSet = true;
+            engine->timeManager.init(engine->startTime, limits.time, limits.increment, limits.movesToGo,
+                                     limits.moveTime, moveOverhead);
+            engine->stopTime = engine->timeManager.hardDeadline();
         }
 
-        if (depth == -1) {
+        if (limits.depth == -1) {
             // we won't ever hit a depth of 100, so it stands in as a "max" or "infinite" depth
-            gondor.mainThread()->engine->limits.depth = 100;
+            engine->limits.depth = 100;
         }
 
-        /*
-        std::cout << "time: " << time << " start: " << AI.startTime.time_since_epoch().count() <<
-        " stop: " << AI.stopTime.time_since_epoch().count() << " depth: " << AI.limit.depth << " timeset: " << AI.limit.timeSet << std::endl;
-         */
+        pool.pondering = limits.ponder;
 
-        if (openingBook.getBookOpen()) {
+        // a book move would have to be sent right away, which we can't do while pondering,
+        // and it might not be one of the moves we were asked to search
+        if (openingBook.getBookOpen() && !limits.ponder && pool.searchMoves.empty()) {
             libchess::Move bestMove = openingBook.getBookMove(board);
             if (bestMove.value() != 0) {
-                std::cout << "bestmove " << bestMove.to_str() << std::endl;
-                board.make_move(bestMove);
+                // a program running us in process owns its position, only the UCI board follows the book move
+                if (!pool.onBestMove) {
+                    board.make_move(bestMove);
+                }
+                sendBestMove(bestMove, libchess::Move(0), pool);
             }
             else {
                 openingBook.flipBookOpen();
                 table.newSearch();
-                gondor.startSearch();
+                pool.startSearch();
             }
         }
         else {
             table.newSearch();
-            gondor.startSearch();
+            pool.startSearch();
+        }
+    }
+
+    void writeInfo(Output::Line &info, const SearchReport &report, const std::vector<libchess::Move> &pv) {
+        info << "info ";
+        if (multiPV > 1) {
+            info << "multipv " << report.line + 1 << " ";
+        }
+
+        info << "score " << (report.mate ? "mate " : "cp ") << report.score
+             << " depth " << report.depth
+             << " seldepth " << report.selDepth
+             << " tbhits " << report.tbHits
+             << (report.upperBound ? " upperbound" : (report.lowerBound ? " lowerbound" : ""))
+             << " nodes " << report.nodes
+             << " nps " << report.nps
+             << " hashfull " << report.hashFull
+             << " time " << report.time
+             << " pv";
+        for (auto m : pv) {
+            info << " " << m;
+        }
+    }
+
+    void sendBestMove(libchess::Move bestMove, libchess::Move ponderMove, ThreadPool &pool) {
+        if (pool.onBestMove) {
+            pool.onBestMove(bestMove, ponderMove);
+            return;
+        }
+
+        Output::Line reply;
+        reply << "bestmove " << bestMove;
+        if (ponderMove.value() != 0) {
+            reply << " ponder " << ponderMove;
         }
+        reply.send();
     }
 
     void parsePosition(std::stringstream &stream, libchess::Position &board) {
@@ -445,18 +1002,57 @@ namespace UCI {
 
 }  // namespace UCI
 
+// idea from Stockfish: helper threads skip some depths so they don't all search the same one as the main thread.
+// helper i searches a depth unless ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) is odd
+constexpr int SKIP_SCHEDULES = 20;
+constexpr int SKIP_SIZE[SKIP_SCHEDULES]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SKIP_PHASE[SKIP_SCHEDULES] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// the score to show for a root move.  Unless the search found a mate, what the root probe told us is worth more
+// than the search score
+static int shownScore(const RootMove &rm, int score, bool rootInTB) {
+    return rootInTB && std::abs(score) < 31000 ? Tablebase::rootScore(rm) : score;
+}
+
 // calls negamax and keeps track of the best move
 // this version will also interact with UCI
 void Anduril::go(libchess::Position board) {
     //std::cout << board.fen() << std::endl;
     libchess::Move bestMove(0);
+    std::vector<libchess::Move> bestPV;
+
+    pool.markStarted();
+    timeTbProbes = debugMode || syzygyStats;
+    tag = pool.hashTag();
+
+    nodeLimited = pool.nodeLimited();
+    quantumEnd = 0;
 
     if (id == 0) {
-        movesExplored = 0;
-        cutNodes = 0;
-        movesTransposed = 0;
-        quiesceExplored = 0;
-        gondor.wakeThreads();
+        stats.clear();
+        callsUntilCheck = callsPerCheck = 0;
+        lastCheck = startTime;
+        lastInfo = {};
+        heldInfo.clear();
+
+        // threads that don't get woken up must not vote with what they found last search
+        for (auto &thread : pool) {
+            thread->engine->result = SearchResult();
+        }
+
+        // the root moves are found and ranked once, and the helpers get a copy before they wake
+        findRootMoves(board);
+
+        if (!(nodeLimited && deterministicNodes)) {
+            for (auto &thread : pool) {
+                if (thread->engine.get() != this) {
+                    thread->engine->rootMoves = rootMoves;
+                    thread->engine->rootInTB = rootInTB;
+                    thread->engine->tbProbing = tbProbing;
+                }
+            }
+            pool.wakeThreads();
+        }
     }
 
     // this is for debugging
@@ -495,19 +1091,15 @@ void Anduril::go(libchess::Position board) {
     singularExtensions = 0;
     bool finalDepth = false;
     bool incomplete = false;
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> timeElapsed = end - startTime;
     bool upper = false;
     bool lower = false;
 
-    // grab the hash for the board, then the node.
-    // if this is our first search, no node will be found, we will look again later if this is the case
-    uint64_t hash = board.hash();
-    bool found = false;
-    Node *node = table.probe(hash, found);
+    // if the tablebases leave a single move there is nothing to think about on the clock
+    bool tbDecided = rootInTB && rootMoves.size() == 1 && limits.timeSet;
 
-    // get the move list for root position
-    rootMoves = board.legal_move_list();
+    // we can't show more lines than we have moves
+    int lines = std::clamp(multiPV, 1, std::max(int(rootMoves.size()), 1));
+    pvIdx = 0;
 
     // iterative deepening loop
     while (!finalDepth) {
@@ -522,6 +1114,13 @@ void Anduril::go(libchess::Position board) {
             sDepth = std::clamp(rDepth, 1, 100);
         }
 
+        // at the start of a new depth, remember how every move did in the last one
+        if (!incomplete && pvIdx == 0) {
+            for (RootMove &rm : rootMoves) {
+                rm.previousScore = rm.score;
+            }
+        }
+
         incomplete = false;
 
         sDepth = std::clamp(sDepth < rDepth - 3 ? rDepth - 3 : sDepth, 1, 100);
@@ -529,14 +1128,15 @@ void Anduril::go(libchess::Position board) {
         // search for the best score
         bestScore = negamax<Root>(board, sDepth, alpha, beta, false);
 
-        // if we didn't find a node before, try again now that we have searched
-        if (!found) {
-            node = table.probe(hash, found);
-        }
+        // put the moves we just searched in order, the lines before pvIdx are already settled for this depth
+        std::stable_sort(rootMoves.begin() + pvIdx, rootMoves.end());
 
         // was the search stopped?
         // stop the search if time is up
-        if (gondor.stop || (limits.timeSet && stopTime - startTime <= std::chrono::steady_clock::now() - startTime)) {
+        if (limits.timeSet && !pool.pondering && std::chrono::steady_clock::now() >= stopTime) {
+            pool.requestStop(stopTime);
+        }
+        if (pool.stop) {
             incomplete = true;
             finalDepth = true;
         }
@@ -544,6 +1144,9 @@ void Anduril::go(libchess::Position board) {
         // this is the depth we just searched to, we save it here because sDepth might change, but we want to report the value before the change to the GUI
         completedDepth = sDepth;
 
+        // same for the line we just searched
+        int line = pvIdx;
+
         // set the aspiration window
         if (rDepth >= 6) {
             // search was outside the window, need to redo the search
@@ -569,10 +1172,18 @@ void Anduril::go(libchess::Position board) {
                 incomplete = true;
                 lower = true;
             }
-            // the search didn't fall outside the window, we can move to the next depth
+            // the search didn't fall outside the window, we can move to the next line
+            else if (++pvIdx < lines) {
+                if (!pool.stop) { finalDepth = false; }
+                upper = lower = false;
+                delta = 14;
+                alpha = std::max(rootMoves[pvIdx].previousScore - delta, -32001);
+                beta = std::min(rootMoves[pvIdx].previousScore + delta, 32001);
+            }
+            // or the next depth if that was the last line
             else {
-                rDepth++;
-                rDepth = std::clamp(rDepth, 1, 100);
+                pvIdx = 0;
+                rDepth = nextDepth(rDepth);
                 upper = lower = false;
                 delta = 14;
                 alpha = std::max(bestScore - delta, -32001);
@@ -582,8 +1193,13 @@ void Anduril::go(libchess::Position board) {
         // for depths less than 5
         else {
             delta = 14;
-            rDepth++;
-            rDepth = std::clamp(rDepth, 1, 100);
+            if (++pvIdx < lines) {
+                if (!pool.stop) { finalDepth = false; }
+            }
+            else {
+                pvIdx = 0;
+                rDepth = nextDepth(rDepth);
+            }
             sDepth = rDepth;
         }
 
@@ -593,103 +1209,50 @@ void Anduril::go(libchess::Position board) {
         // 3 / 4
         delta += delta * 29 / 40;
 
-        if (!incomplete && found) {
-            bestMove = board.from_table(node->bestMove);
-            prevBestScore = bestScore;
+        // a later line can beat an earlier one, so the finished lines are sorted again before we pick the best move
+        if (!incomplete && !rootMoves.empty()) {
+            std::stable_sort(rootMoves.begin(), rootMoves.begin() + line + 1);
+            bestMove = rootMoves[0].move;
+            bestPV = rootMoves[0].pv;
+            prevBestScore = rootMoves[0].score;
+
+            // publish the result so the main thread can count our vote
+            result.depth = completedDepth;
+            result.score = prevBestScore;
+            result.selDepth = rootMoves[0].selDepth;
+            result.pv = bestPV;
             //std::cout << "Total low misses: " << aspMissesL << std::endl;
             //std::cout << "Total high misses: " << aspMissesH << std::endl;
         }
 
+        if (tbDecided && !incomplete && pvIdx == 0) {
+            finalDepth = true;
+        }
+
+        // see if the time manager thinks another iteration is worth it
+        if (id == 0 && !incomplete && pvIdx == 0 && !finalDepth && limits.timeSet && !pool.pondering && bestMove.value() != 0) {
+            uint64_t nodes = stats.movesExplored.load();
+            double fraction = nodes ? double(rootMoves[0].nodes) / double(nodes) : 0;
+            if (timeManager.stopAfterIteration(bestMove, prevBestScore, fraction)) {
+                finalDepth = true;
+            }
+        }
+
         if (id == 0) {
-            // send info to the GUI
-            end = std::chrono::steady_clock::now();
-            timeElapsed = end - startTime;
-
-            std::vector<libchess::Move> PV = getPV(board, rDepth, bestMove);
-            std::string pv = "";
-            for (auto m: PV) {
-                pv += " " + m.to_str();
-            }
-
-            if (!incomplete) {
-                if (prevBestScore >= 31000) {
-                    int distance = ((-prevBestScore + 32000) / 2) + (prevBestScore % 2);
-                    std::cout << "info "
-                              << "score mate " << distance
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
-                } else if (prevBestScore <= -31000) {
-                    int distance = -((prevBestScore + 32000) / 2) + -(prevBestScore % 2);
-                    std::cout << "info "
-                              << "score mate " << distance
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
-                } else {
-                    std::cout << "info "
-                              << "score cp " << (prevBestScore * 100 / 208) // this is the centipawn conversion stockfish used in the version the default network file was trained on
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
+            // send info to the GUI once every line of this depth is done
+            if (!incomplete && line == lines - 1) {
+                bool hold = holdInfo();
+                heldInfo.clear();
+                for (int k = 0; k < lines; k++) {
+                    int score = shownScore(rootMoves[k], rootMoves[k].score, rootInTB);
+                    sendInfo(k, score, completedDepth, rootMoves[k].selDepth, false, false, rootMoves[k].pv, hold);
                 }
             }
-                // still give some info on a fail high or low
-            else {
-                if (prevBestScore >= 31000) {
-                    int distance = ((-prevBestScore + 32000) / 2) + (prevBestScore % 2);
-                    std::cout << "info "
-                              << "score mate " << distance
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << (upper ? " upperbound" : (lower ? " lowerbound" : ""))
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
-                } else if (prevBestScore <= -31000) {
-                    int distance = -((prevBestScore + 32000) / 2) + -(prevBestScore % 2);
-                    std::cout << "info "
-                              << "score mate " << distance
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << (upper ? " upperbound" : (lower ? " lowerbound" : ""))
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
-                } else {
-                    std::cout << "info "
-                              << "score cp " << (prevBestScore * 100 / 208) // this is the centipawn conversion stockfish used in the version the default network file was trained on
-                              << " depth " << completedDepth
-                              << " seldepth " << selDepth
-                              << " tbhits " << getTbHits()
-                              << (upper ? " upperbound" : (lower ? " lowerbound" : ""))
-                              << " nodes " << getMovesExplored()
-                              << " nps " << (uint64_t) (getMovesExplored() / (timeElapsed.count() / 1000))
-                              << " hashfull " << table.hashFull()
-                              << " time " << (uint64_t) timeElapsed.count()
-                              << " pv" << pv << std::endl;
-                }
+            // still give some info on a fail high or low, once we have a score to give
+            else if (incomplete && line == 0 && prevBestScore != -32001) {
+                bool hold = holdInfo();
+                heldInfo.clear();
+                sendInfo(0, prevBestScore, completedDepth, selDepth, upper, lower, bestPV, hold);
             }
             //std::cout << "info string Attempts at Singular Extensions: " << singularAttempts << std::endl;
             //std::cout << "info string Number of Singular Extensions: " << singularExtensions << std::endl;
@@ -706,9 +1269,9 @@ void Anduril::go(libchess::Position board) {
             }
 
             /*
-            std::cout << "Total Quiescence Moves Searched: " << quiesceExplored << std::endl;
-            std::cout << "Moves transposed: " << movesTransposed << std::endl;
-            std::cout << "Cut Nodes: " << cutNodes << std::endl;
+            std::cout << "Total Quiescence Moves Searched: " << pool.sum(&SearchStats::quiesceExplored) << std::endl;
+            std::cout << "Moves transposed: " << pool.sum(&SearchStats::movesTransposed) << std::endl;
+            std::cout << "Cut Nodes: " << pool.sum(&SearchStats::cutNodes) << std::endl;
              */
         }
 
@@ -719,23 +1282,172 @@ void Anduril::go(libchess::Position board) {
     }
 
     if (id == 0) {
-        gondor.stop = true;
-        cutNodes = 0;
-        movesTransposed = 0;
-        quiesceExplored = 0;
+        // we can't send our move while pondering, so if the search ran out early we wait for ponderhit or stop
+        while (pool.pondering && !pool.stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        pool.stop = true;
 
         // stop the other threads
-        gondor.waitForSearchFinish();
+        pool.waitForSearchFinish();
+
+        // the GUI has to see the newest info before bestmove, even if it came too quickly after the one before
+        sendHeldInfo(false);
+
+        // let the threads vote on the move, unless the GUI asked for something we want to be reproducible
+        if (multiPV == 1 && limits.depth == 100 && pool.numThreads > 1) {
+            const SearchResult &best = pool.bestThread()->engine->result;
+            if (!best.pv.empty() && best.pv[0] != bestMove) {
+                bestMove = best.pv[0];
+                bestPV = best.pv;
+
+                // the helper's raw score would contradict the tablebase scores we showed before
+                int score = best.score;
+                auto rm = std::find_if(rootMoves.begin(), rootMoves.end(),
+                                       [&](const RootMove &m) { return m.move == bestMove; });
+                if (rm != rootMoves.end()) {
+                    score = shownScore(*rm, score, rootInTB);
+                }
+                sendInfo(0, score, best.depth, best.selDepth, false, false, best.pv, false);
+            }
+        }
+
+        // how long it took from the deadline or stop command until every thread was done
+        double latency = pool.stopLatency();
+        if (debugMode && latency >= 0) {
+            std::cout << "info string stop latency " << latency << " ms" << std::endl;
+        }
+        if (debugMode && limits.timeSet) {
+            std::cout << "info string time used " << timeManager.elapsed() << " ms soft limit " << timeManager.softLimit()
+                      << " ms hard limit " << timeManager.hardLimit() << " ms" << std::endl;
+        }
+
+        // collect the tablebase probe latencies from every thread
+        Tablebase::ProbeStats probeStats;
+        for (auto &thread : pool) {
+            probeStats.add(thread->engine->tbStats);
+            thread->engine->tbStats.clear();
+        }
+        if (probeStats.probes()) {
+            std::lock_guard<std::mutex> lock(tbTotalsMutex);
+            tbTotals.add(probeStats);
+        }
+        if (debugMode && probeStats.probes()) {
+            Tablebase::reportStats(probeStats);
+        }
 
         // reset the node count for each thread
-        for (auto &thread : gondor) {
-            thread->engine->setMovesExplored(0);
-            thread->engine->setTbHits(0);
+        for (auto &thread : pool) {
+            thread->engine->stats.clear();
+        }
+
+        // the clock can run out before the first depth is done, any legal move is better than a null one
+        if (bestMove.value() == 0 && !rootMoves.empty()) {
+            bestMove = rootMoves[0].move;
+            bestPV = {bestMove};
         }
 
-        // tell the GUI what move we want to make
-        std::cout << "bestmove " << bestMove.to_str() << std::endl;
+        // tell the GUI what move we want to make, and the reply we expect so it can ponder on it
+        UCI::sendBestMove(bestMove, bestPV.size() > 1 ? bestPV[1] : libchess::Move(0), pool);
     }
 
     //std::cout << board.fen() << std::endl;
-}
\ No newline at end of file
+}
+
+void Anduril::findRootMoves(libchess::Position &board) {
+    // keep only the moves from searchmoves if we were given any
+    rootMoves.clear();
+    for (libchess::Move move : board.legal_move_list()) {
+        if (pool.searchMoves.empty()
+            || std::any_of(pool.searchMoves.begin(), pool.searchMoves.end(), [move](libchess::Move m) {
+                   return m.from_square() == move.from_square() && m.to_square() == move.to_square()
+                          && m.promotion_piece_type() == move.promotion_piece_type();
+               })) {
+            rootMoves.emplace_back(move);
+        }
+    }
+
+    // none of the moves we were given are legal, so search everything rather than nothing
+    if (rootMoves.empty()) {
+        for (libchess::Move move : board.legal_move_list()) {
+            rootMoves.emplace_back(move);
+        }
+    }
+
+    // in tablebase positions only the moves that keep the best result are searched.  With DTZ the ranking already
+    // makes progress, so probing in the search is only worth it if all we have is WDL and we are winning
+    bool dtzAvailable = false;
+    rootInTB = Tablebase::rankRootMoves(board, rootMoves, dtzAvailable);
+    tbProbing = !rootInTB || (!dtzAvailable && rootMoves[0].tbRank > 0);
+}
+
+int Anduril::nextDepth(int depth) const {
+    depth = std::min(depth + 1, 100);
+    if (id != 0) {
+        int i = (id - 1) % SKIP_SCHEDULES;
+        while (depth < 100 && ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+void Anduril::sendHeldInfo(bool droppable) {
+    for (const Output::Line &info : heldInfo) {
+        info.send(droppable);
+    }
+    heldInfo.clear();
+    lastInfo = std::chrono::steady_clock::now();
+}
+
+bool Anduril::holdInfo() const {
+    std::chrono::duration<double, std::milli> sinceLast = std::chrono::steady_clock::now() - lastInfo;
+    return sinceLast.count() < INFO_INTERVAL_MS;
+}
+
+void Anduril::sendInfo(int line, int score, int depth, int seldepth, bool upper, bool lower, const std::vector<libchess::Move> &pv, bool hold) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> timeElapsed = now - startTime;
+
+    SearchReport report;
+    report.line = line;
+    report.mate = score >= 31000 || score <= -31000;
+    if (score >= 31000) {
+        report.score = ((-score + 32000) / 2) + (score % 2);
+    }
+    else if (score <= -31000) {
+        report.score = -((score + 32000) / 2) + -(score % 2);
+    }
+    else {
+        // this is the centipawn conversion stockfish used in the version the default network file was trained on
+        report.score = score * 100 / 208;
+    }
+    report.upperBound = upper;
+    report.lowerBound = !upper && lower;
+    report.depth = depth;
+    report.selDepth = seldepth;
+    report.nodes = getMovesExplored();
+    report.nps = (uint64_t) (report.nodes / (timeElapsed.count() / 1000));
+    report.tbHits = getTbHits();
+    report.hashFull = table.hashFull();
+    report.time = (uint64_t) timeElapsed.count();
+
+    if (pool.onInfo) {
+        report.pv = pv;
+        pool.onInfo(report);
+        return;
+    }
+
+    Output::Line info;
+    UCI::writeInfo(info, report, pv);
+
+    if (hold) {
+        heldInfo.push_back(info);
+        return;
+    }
+
+    // the GUI would rather miss an info line than have the search wait on it
+    lastInfo = now;
+    info.send(true);
+}
@@ -5,21 +5,74 @@
 #ifndef ANDURIL_ENGINE_UCI_H
 #define ANDURIL_ENGINE_UCI_H
 
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
 #include "Anduril.h"
 #include "PolyglotBook.h"
 
 namespace UCI {
+    // FEN for the start position
+    extern const char* StartFEN;
+
+    // what a go command asked for.  Times are in milliseconds for the side to move, -1 when not given
+    struct GoLimits {
+        int depth = -1;
+        int moveTime = -1;
+        int movesToGo = -1;
+        int time = -1;
+        int increment = 0;
+        int64_t nodes = -1;
+        bool ponder = false;
+        bool infinite = false;
+
+        // the root moves to search, empty for all of them
+        std::vector<libchess::Move> searchMoves;
+
+        // the clock starts as soon as we know about the search, to help avoid time loss with an extremely low clock
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+
     // main UCI loop
     void loop(int argc, char* argv[]);
 
+    // launches the engine at self the given number of times and reports how long each took to send uciok
+    void startupBench(const char* self, int runs);
+
+    // starts and stops short searches with the given number of threads, and reports how long it took from go until
+    // every thread was searching, and from stop until the bestmove was sent
+    void threadBench(libchess::Position &board, int threads, int runs);
+
+    // loads the tablebases at path fresh for every run and has all the threads probe the same endgame at once,
+    // then reports how long the first probe into the cold table took and what the probes after it cost
+    void tbBench(const char* path, int threads, int runs);
+
+    // runs the same short searches through the in-process Engine and through a copy of the engine at self talking
+    // UCI over pipes, and reports the requests per second of each
+    void apiBench(const char* self, int requests, int depth);
+
     // parses the go command from the GUI
     void parseGo(std::stringstream &stream, libchess::Position &board, Book &openingBook, bool &bookOpen);
 
+    // sets the limits and starts the pool's threads, or plays a book move right away if the book has one
+    void startSearch(const GoLimits &limits, libchess::Position &board, Book &openingBook, bool &bookOpen,
+                     ThreadPool &pool);
+
+    // puts an info line together from a report, pv is passed on its own so the search doesn't have to copy it
+    void writeInfo(Output::Line &info, const SearchReport &report, const std::vector<libchess::Move> &pv);
+
+    // sends bestmove, or hands it to the pool's callback if one is set.  A ponder move of 0 is left out
+    void sendBestMove(libchess::Move bestMove, libchess::Move ponderMove, ThreadPool &pool);
+
     // parses position commands from the GUI
     void parsePosition(std::stringstream &stream, libchess::Position &board);
 
+    // builds a polyglot book from a PGN or UCI move list file
+    void parseMakeBook(std::stringstream &stream);
+
     // parses options
-    void parseOption(std::stringstream &stream, libchess::Position &board, bool &bookOpen);
+    void parseOption(std::stringstream &stream, libchess::Position &board, Book &openingBook, bool &bookOpen);
 
     static double nem = 2.3807;
     static double neb = -0.2408;
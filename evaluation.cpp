@@ -1119,7 +1119,7 @@ int Anduril::space(libchess::Position &board) {
     int totalNPM = (4 * (libchess::Position::pieceValuesMG[1] + libchess::Position::pieceValuesMG[2] + libchess::Position::pieceValuesMG[3])) + (2 * libchess::Position::pieceValuesMG[4]);
     int delta = 3 * (libchess::Position::pieceValuesMG[1] + libchess::Position::pieceValuesMG[2]);
     int threshold = totalNPM - delta + 1;
-    if (nonPawnMaterial(true, board) + nonPawnMaterial(false, board) < threshold) {
+    if (board.non_pawn_material(libchess::constants::WHITE) + board.non_pawn_material(libchess::constants::BLACK) < threshold) {
         return 0;
     }
 
@@ -1147,10 +1147,12 @@ int Anduril::getPhase(libchess::Position &board) {
     int totalPhase = knight*4 + bishop*4 + rook*4 + queen*2;
 
     int phase = totalPhase;
-    phase -= board.piece_type_bb(libchess::constants::KNIGHT).popcount() * knight;
-    phase -= board.piece_type_bb(libchess::constants::BISHOP).popcount() * bishop;
-    phase -= board.piece_type_bb(libchess::constants::ROOK).popcount() * rook;
-    phase -= board.piece_type_bb(libchess::constants::QUEEN).popcount() * queen;
+    for (libchess::Color c : libchess::constants::COLORS) {
+        phase -= board.piece_count(libchess::constants::KNIGHT, c) * knight;
+        phase -= board.piece_count(libchess::constants::BISHOP, c) * bishop;
+        phase -= board.piece_count(libchess::constants::ROOK, c) * rook;
+        phase -= board.piece_count(libchess::constants::QUEEN, c) * queen;
+    }
 
     return ((phase * 256 + (totalPhase / 2)) / totalPhase);
 }
\ No newline at end of file
@@ -39,7 +39,7 @@ constexpr static Bitboard FILE_F_MASK{std::uint64_t(0x2020202020202020)};
 constexpr static Bitboard FILE_G_MASK{std::uint64_t(0x4040404040404040)};
 constexpr static Bitboard FILE_H_MASK{std::uint64_t(0x8080808080808080)};
 
-static std::array<Bitboard, 8> RANK_MASK = {RANK_1_MASK,
+constexpr static std::array<Bitboard, 8> RANK_MASK = {RANK_1_MASK,
                                             RANK_2_MASK,
                                             RANK_3_MASK,
                                             RANK_4_MASK,
@@ -47,7 +47,7 @@ static std::array<Bitboard, 8> RANK_MASK = {RANK_1_MASK,
                                             RANK_6_MASK,
                                             RANK_7_MASK,
                                             RANK_8_MASK};
-static std::array<Bitboard, 8> FILE_MASK = {FILE_A_MASK,
+constexpr static std::array<Bitboard, 8> FILE_MASK = {FILE_A_MASK,
                                             FILE_B_MASK,
                                             FILE_C_MASK,
                                             FILE_D_MASK,
@@ -56,16 +56,16 @@ static std::array<Bitboard, 8> FILE_MASK = {FILE_A_MASK,
                                             FILE_G_MASK,
                                             FILE_H_MASK};
 
-inline Bitboard rank_mask(Rank rank) {
+constexpr Bitboard rank_mask(Rank rank) {
     return RANK_MASK[rank.value()];
 }
-inline Bitboard file_mask(File file) {
+constexpr Bitboard file_mask(File file) {
     return FILE_MASK[file.value()];
 }
 
 namespace init {
 
-inline std::array<Bitboard, 64> north() {
+constexpr std::array<Bitboard, 64> north() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H7; ++sq) {
         Bitboard bb;
@@ -77,7 +77,7 @@ inline std::array<Bitboard, 64> north() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> south() {
+constexpr std::array<Bitboard, 64> south() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A2; sq <= constants::H8; ++sq) {
         Bitboard bb;
@@ -89,7 +89,7 @@ inline std::array<Bitboard, 64> south() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> east() {
+constexpr std::array<Bitboard, 64> east() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::G8; ++sq) {
         Bitboard bb;
@@ -104,7 +104,7 @@ inline std::array<Bitboard, 64> east() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> west() {
+constexpr std::array<Bitboard, 64> west() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::B1; sq <= constants::H8; ++sq) {
         Bitboard bb;
@@ -119,7 +119,7 @@ inline std::array<Bitboard, 64> west() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> northwest() {
+constexpr std::array<Bitboard, 64> northwest() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H7; ++sq) {
         Bitboard bb;
@@ -134,7 +134,7 @@ inline std::array<Bitboard, 64> northwest() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> southwest() {
+constexpr std::array<Bitboard, 64> southwest() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::B2; sq <= constants::H8; ++sq) {
         Bitboard bb;
@@ -149,7 +149,7 @@ inline std::array<Bitboard, 64> southwest() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> northeast() {
+constexpr std::array<Bitboard, 64> northeast() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::G7; ++sq) {
         Bitboard bb;
@@ -164,7 +164,7 @@ inline std::array<Bitboard, 64> northeast() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> southeast() {
+constexpr std::array<Bitboard, 64> southeast() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A2; sq <= constants::H8; ++sq) {
         Bitboard bb;
@@ -179,7 +179,7 @@ inline std::array<Bitboard, 64> southeast() {
     return attacks;
 }
 
-inline std::array<std::array<Bitboard, 64>, 64> intervening() {
+constexpr std::array<std::array<Bitboard, 64>, 64> intervening() {
     std::array<std::array<Bitboard, 64>, 64> intervening_bb{};
     for (Square from = constants::A1; from <= constants::H8; ++from) {
         for (Square to = constants::A1; to <= constants::H8; ++to) {
@@ -218,7 +218,7 @@ inline std::array<std::array<Bitboard, 64>, 64> intervening() {
 }
 
 // added by krtoonbrat
-inline std::array<Bitboard, 64> squares() {
+constexpr std::array<Bitboard, 64> squares() {
     std::array<Bitboard, 64> squares_bb{};
     for (Square s = constants::A1; s <= constants::H8; s++) {
         squares_bb[s] = Bitboard(s);
@@ -230,19 +230,19 @@ inline std::array<Bitboard, 64> squares() {
 
 // added by krtoonbrat
 // Square bitboards
-extern std::array<Bitboard, 64> SQUARES;
+extern const std::array<Bitboard, 64> SQUARES;
 
 // Direction bitboards
-extern std::array<Bitboard, 64> NORTH;
-extern std::array<Bitboard, 64> SOUTH;
-extern std::array<Bitboard, 64> EAST;
-extern std::array<Bitboard, 64> WEST;
-extern std::array<Bitboard, 64> NORTHWEST;
-extern std::array<Bitboard, 64> SOUTHWEST;
-extern std::array<Bitboard, 64> NORTHEAST;
-extern std::array<Bitboard, 64> SOUTHEAST;
-extern std::array<std::array<Bitboard, 64>, 64> INTERVENING;
-extern std::array<std::array<uint8_t, 64>, 64> squareDistance;
+extern const std::array<Bitboard, 64> NORTH;
+extern const std::array<Bitboard, 64> SOUTH;
+extern const std::array<Bitboard, 64> EAST;
+extern const std::array<Bitboard, 64> WEST;
+extern const std::array<Bitboard, 64> NORTHWEST;
+extern const std::array<Bitboard, 64> SOUTHWEST;
+extern const std::array<Bitboard, 64> NORTHEAST;
+extern const std::array<Bitboard, 64> SOUTHEAST;
+extern const std::array<std::array<Bitboard, 64>, 64> INTERVENING;
+extern const std::array<std::array<uint8_t, 64>, 64> squareDistance;
 
 // added by krtoonbrat
 static Bitboard square(Square square) {
@@ -279,7 +279,7 @@ static Bitboard intervening(Square from, Square to) {
 
 namespace init {
 
-inline std::array<std::array<libchess::Bitboard, 64>, 2> pawn_attacks() {
+constexpr std::array<std::array<libchess::Bitboard, 64>, 2> pawn_attacks() {
     std::array<std::array<libchess::Bitboard, 64>, 2> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
         if (sq <= constants::H7) {
@@ -298,7 +298,7 @@ inline std::array<std::array<libchess::Bitboard, 64>, 2> pawn_attacks() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> knight_attacks() {
+constexpr std::array<Bitboard, 64> knight_attacks() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
         if (sq <= constants::G6) {
@@ -329,7 +329,7 @@ inline std::array<Bitboard, 64> knight_attacks() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> king_attacks() {
+constexpr std::array<Bitboard, 64> king_attacks() {
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
         if (sq <= constants::G7) {
@@ -356,30 +356,29 @@ inline std::array<Bitboard, 64> king_attacks() {
     return attacks;
 }
 
-inline std::array<Bitboard, 64> bishop_attacks() {
+constexpr std::array<Bitboard, 64> bishop_attacks() {
+    const auto ne = northeast(), se = southeast(), sw = southwest(), nw = northwest();
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
-        attacks[sq] = lookups::northeast(sq) | lookups::southeast(sq) | lookups::southwest(sq) |
-                      lookups::northwest(sq);
+        attacks[sq] = ne[sq] | se[sq] | sw[sq] | nw[sq];
     }
     return attacks;
 }
 
-inline std::array<Bitboard, 64> rook_attacks() {
+constexpr std::array<Bitboard, 64> rook_attacks() {
+    const auto n = north(), e = east(), s = south(), w = west();
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
-        attacks[sq] =
-            lookups::north(sq) | lookups::east(sq) | lookups::south(sq) | lookups::west(sq);
+        attacks[sq] = n[sq] | e[sq] | s[sq] | w[sq];
     }
     return attacks;
 }
 
-inline std::array<Bitboard, 64> queen_attacks() {
+constexpr std::array<Bitboard, 64> queen_attacks() {
+    const auto bishop = bishop_attacks(), rook = rook_attacks();
     std::array<Bitboard, 64> attacks{};
     for (Square sq = constants::A1; sq <= constants::H8; ++sq) {
-        attacks[sq] = lookups::north(sq) | lookups::east(sq) | lookups::south(sq) |
-                      lookups::west(sq) | lookups::northwest(sq) | lookups::northeast(sq) |
-                      lookups::southwest(sq) | lookups::southeast(sq);
+        attacks[sq] = bishop[sq] | rook[sq];
     }
     return attacks;
 }
@@ -387,12 +386,12 @@ inline std::array<Bitboard, 64> queen_attacks() {
 }  // namespace init
 
 // Piece attack bitboards
-extern std::array<std::array<Bitboard, 64>, 2> PAWN_ATTACKS;
-extern std::array<Bitboard, 64> KNIGHT_ATTACKS;
-extern std::array<Bitboard, 64> KING_ATTACKS;
-extern std::array<Bitboard, 64> BISHOP_ATTACKS;
-extern std::array<Bitboard, 64> ROOK_ATTACKS;
-extern std::array<Bitboard, 64> QUEEN_ATTACKS;
+extern const std::array<std::array<Bitboard, 64>, 2> PAWN_ATTACKS;
+extern const std::array<Bitboard, 64> KNIGHT_ATTACKS;
+extern const std::array<Bitboard, 64> KING_ATTACKS;
+extern const std::array<Bitboard, 64> BISHOP_ATTACKS;
+extern const std::array<Bitboard, 64> ROOK_ATTACKS;
+extern const std::array<Bitboard, 64> QUEEN_ATTACKS;
 
 inline Bitboard pawn_attacks(Square square, Color color) {
     return PAWN_ATTACKS[color][square];
@@ -478,17 +477,24 @@ template<> inline int distance<File>(Square x, Square y) { return std::abs(x.fil
 template<> inline int distance<Rank>(Square x, Square y) { return std::abs(x.rank().value() - y.rank().value()); }
 template<> inline int distance<Square>(Square x, Square y) { return squareDistance[x][y]; }
 
-inline std::array<std::array<uint8_t, 64>, 64> square_distance() {
+namespace init {
+
+constexpr std::array<std::array<uint8_t, 64>, 64> square_distance() {
     std::array<std::array<uint8_t, 64>, 64> d{};
     for (Square s1 = constants::A1; s1 <= constants::H8; ++s1) {
         for (Square s2 = constants::A1; s2 <= constants::H8; ++s2) {
-            d[s1][s2] = std::max(distance<File>(s1, s2), distance<Rank>(s1, s2));
+            int file_distance = s1.file() - s2.file();
+            int rank_distance = s1.rank() - s2.rank();
+            d[s1][s2] = std::max(file_distance < 0 ? -file_distance : file_distance,
+                                 rank_distance < 0 ? -rank_distance : rank_distance);
         }
     }
 
     return d;
 }
 
+}  // namespace init
+
 inline Bitboard least_significant_square_bb(Bitboard b) {
     return square(b.forward_bitscan());
 }
@@ -526,7 +532,7 @@ inline Bitboard rook_attacks_classical(Square square, Bitboard occupancy) {
 struct Magic {
     Bitboard mask;
     Bitboard magic;
-    Bitboard* attacks;
+    const Bitboard* attacks;
     unsigned shift;
 
     // Computes the attack index
@@ -540,113 +546,163 @@ struct Magic {
     }
 };
 
-extern Magic rook_magics[64];
-extern Magic bishop_magics[64];
-
-extern Bitboard rook_table[0x19000];
-extern Bitboard bishop_table[0x1480];
-
-/// xorshift64star Pseudo-Random Number Generator
-/// This class is based on original code written and dedicated
-/// to the public domain by Sebastiano Vigna (2014).
-/// It has the following characteristics:
-///
-///  -  Outputs 64-bit numbers
-///  -  Passes Dieharder and SmallCrush test batteries
-///  -  Does not require warm-up, no zeroland to escape
-///  -  Internal state is a single 64-bit integer
-///  -  Period is 2^64 - 1
-///  -  Speed: 1.60 ns/call (Core i7 @3.40GHz)
-///
-/// For further analysis see
-///   <http://vigna.di.unimi.it/ftp/papers/xorshift.pdf>
+// number of attack sets needed over every square for each slider
+constexpr std::size_t ROOK_TABLE_SIZE = 0x19000;
+constexpr std::size_t BISHOP_TABLE_SIZE = 0x1480;
 
-class PRNG {
+extern const std::array<Magic, 64> rook_magics;
+extern const std::array<Magic, 64> bishop_magics;
 
-  uint64_t s;
+extern const std::array<Bitboard, ROOK_TABLE_SIZE> rook_table;
+extern const std::array<Bitboard, BISHOP_TABLE_SIZE> bishop_table;
 
-  uint64_t rand64() {
-
-    s ^= s >> 12, s ^= s << 25, s ^= s >> 27;
-    return s * 2685821657736338717LL;
-  }
-
-public:
-  PRNG(uint64_t seed) : s(seed) { assert(seed); }
+namespace init {
 
-  template<typename T> T rand() { return T(rand64()); }
+// The magics are built at compile time now, so we can't afford to search for them like stockfish does.
+// These are the numbers the old xorshift search settled on for each square, they are only used without PEXT
+constexpr std::uint64_t ROOK_MAGICS[64] = {
+    0x0A80004000801220ULL, 0x8040004010002008ULL, 0x2080200010008008ULL, 0x1100100008210004ULL,
+    0xC200209084020008ULL, 0x2100010004000208ULL, 0x0400081000822421ULL, 0x0200010422048844ULL,
+    0x0800800080400024ULL, 0x0001402000401000ULL, 0x3000801000802001ULL, 0x4400800800100083ULL,
+    0x0904802402480080ULL, 0x4040800400020080ULL, 0x0018808042000100ULL, 0x4040800080004100ULL,
+    0x0040048001458024ULL, 0x00A0004000205000ULL, 0x3100808010002000ULL, 0x4825010010000820ULL,
+    0x5004808008000401ULL, 0x2024818004000A00ULL, 0x0005808002000100ULL, 0x2100060004806104ULL,
+    0x0080400880008421ULL, 0x4062220600410280ULL, 0x010A004A00108022ULL, 0x0000100080080080ULL,
+    0x0021000500080010ULL, 0x0044000202001008ULL, 0x0000100400080102ULL, 0xC020128200040545ULL,
+    0x0080002000400040ULL, 0x0000804000802004ULL, 0x0000120022004080ULL, 0x010A386103001001ULL,
+    0x9010080080800400ULL, 0x8440020080800400ULL, 0x0004228824001001ULL, 0x000000490A000084ULL,
+    0x0080002000504000ULL, 0x200020005000C000ULL, 0x0012088020420010ULL, 0x0010010080080800ULL,
+    0x0085001008010004ULL, 0x0002000204008080ULL, 0x0040413002040008ULL, 0x0000304081020004ULL,
+    0x0080204000800080ULL, 0x3008804000290100ULL, 0x1010100080200080ULL, 0x2008100208028080ULL,
+    0x5000850800910100ULL, 0x8402019004680200ULL, 0x0120911028020400ULL, 0x0000008044010200ULL,
+    0x0020850200244012ULL, 0x0020850200244012ULL, 0x0000102001040841ULL, 0x140900040A100021ULL,
+    0x000200282410A102ULL, 0x000200282410A102ULL, 0x000200282410A102ULL, 0x4048240043802106ULL
+};
 
-  /// Special generator used to fast init magic numbers.
-  /// Output values only have 1/8th of their bits set on average.
-  template<typename T> T sparse_rand()
-  { return T(rand64() & rand64() & rand64()); }
+constexpr std::uint64_t BISHOP_MAGICS[64] = {
+    0x40106000A1160020ULL, 0x0020010250810120ULL, 0x2010010220280081ULL, 0x002806004050C040ULL,
+    0x0002021018000000ULL, 0x2001112010000400ULL, 0x0881010120218080ULL, 0x1030820110010500ULL,
+    0x0000120222042400ULL, 0x2000020404040044ULL, 0x8000480094208000ULL, 0x0003422A02000001ULL,
+    0x000A220210100040ULL, 0x8004820202226000ULL, 0x0018234854100800ULL, 0x0100004042101040ULL,
+    0x0004001004082820ULL, 0x0010000810010048ULL, 0x1014004208081300ULL, 0x2080818802044202ULL,
+    0x0040880C00A00100ULL, 0x0080400200522010ULL, 0x0001000188180B04ULL, 0x0080249202020204ULL,
+    0x1004400004100410ULL, 0x00013100A0022206ULL, 0x2148500001040080ULL, 0x4241080011004300ULL,
+    0x4020848004002000ULL, 0x10101380D1004100ULL, 0x0008004422020284ULL, 0x01010A1041008080ULL,
+    0x0808080400082121ULL, 0x0808080400082121ULL, 0x0091128200100C00ULL, 0x0202200802010104ULL,
+    0x8C0A020200440085ULL, 0x01A0008080B10040ULL, 0x0889520080122800ULL, 0x100902022202010AULL,
+    0x04081A0816002000ULL, 0x0000681208005000ULL, 0x8170840041008802ULL, 0x0A00004200810805ULL,
+    0x0830404408210100ULL, 0x2602208106006102ULL, 0x1048300680802628ULL, 0x2602208106006102ULL,
+    0x0602010120110040ULL, 0x0941010801043000ULL, 0x000040440A210428ULL, 0x0008240020880021ULL,
+    0x0400002012048200ULL, 0x00AC102001210220ULL, 0x0220021002009900ULL, 0x84440C080A013080ULL,
+    0x0001008044200440ULL, 0x0004C04410841000ULL, 0x2000500104011130ULL, 0x1A0C010011C20229ULL,
+    0x0044800112202200ULL, 0x0434804908100424ULL, 0x0300404822C08200ULL, 0x48081010008A2A80ULL
 };
 
-namespace init {
+// attacks of a slider found by walking each direction until we hit a blocker
+// queens are handled as well, which is handy for anything that needs empty board attacks before the tables exist
+constexpr Bitboard sliding_attacks(PieceType pt, Square square, Bitboard occupancy) {
+    constexpr int directions[8][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    const int first = pt == constants::ROOK ? 4 : 0;
+    const int last = pt == constants::BISHOP ? 4 : 8;
+
+    const std::uint64_t occupied = occupancy;
+    std::uint64_t attacks = 0;
+    for (int d = first; d < last; ++d) {
+        int file = (square.value() & 7) + directions[d][0];
+        int rank = (square.value() >> 3) + directions[d][1];
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            std::uint64_t bb = std::uint64_t(1) << (rank * 8 + file);
+            attacks |= bb;
+            if (occupied & bb) {
+                break;
+            }
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return Bitboard{attacks};
+}
 
-inline void init_magics(PieceType pt, Bitboard table[], Magic magics[]) {
-    // Optimal PRNG seeds to pick the correct magics in the shortest time
-    int seeds[][8] = { { 8977, 44560, 54343, 38998,  5731, 95205, 104912, 17020 },
-                             {  728, 10316, 55013, 32803, 12281, 15100,  16645,   255 } };
+// everything but the attack pointer
+constexpr Magic magic_entry(PieceType pt, Square square) {
+    Bitboard edges = ((FILE_A_MASK | FILE_H_MASK) & ~file_mask(square.file())) |
+                     ((RANK_1_MASK | RANK_8_MASK) & ~rank_mask(square.rank()));
 
-    Bitboard occupancy[4096], reference[4096], edges, b;
-    int epoch[4096] = {}, cnt = 0, size = 0;
+    Magic m{};
+    m.mask = sliding_attacks(pt, square, Bitboard{}) & ~edges;
+    m.magic = Bitboard{pt == constants::ROOK ? ROOK_MAGICS[square] : BISHOP_MAGICS[square]};
+    m.shift = 64 - m.mask.popcount();
+    return m;
+}
 
+// each square gets a slice of the table sized for every subset of its mask, one after another
+constexpr std::array<Magic, 64> magics(PieceType pt, const Bitboard* table) {
+    std::array<Magic, 64> magics{};
+    std::size_t offset = 0;
     for (Square square = constants::A1; square <= constants::H8; ++square) {
-        edges = ((FILE_A_MASK | FILE_H_MASK) & ~file_mask(square.file())) |
-                         ((RANK_1_MASK | RANK_8_MASK) & ~rank_mask(square.rank()));
-
-        Magic& m = magics[square];
-        m.mask = (pt == constants::ROOK ? lookups::rook_attacks(square) : lookups::bishop_attacks(square)) & ~edges;
-        m.shift = 64 - m.mask.popcount();
-
-        m.attacks = square == constants::A1 ? table : magics[square - 1].attacks + size;
-
-        size = 0;
-        b = Bitboard();
-        do {
-            occupancy[size] = b;
-            reference[size] = (pt == constants::ROOK ? lookups::rook_attacks_classical(square, b) : lookups::bishop_attacks_classical(square, b));
-
-            if (has_pext) {
-                m.attacks[pext(b, m.mask)] = reference[size];
+        magics[square] = magic_entry(pt, square);
+        magics[square].attacks = table + offset;
+        offset += std::size_t(1) << magics[square].mask.popcount();
+    }
+    return magics;
+}
+
+template<std::size_t N>
+constexpr std::array<Bitboard, N> magic_table(PieceType pt) {
+    // walking the board for each of the ~100k entries is too slow for the compiler, so we walk every ray once
+    // and cut them off at the nearest blocker instead.  Bishop directions come first, then rook directions
+    constexpr int directions[8][2] = {{1, 1}, {-1, 1}, {1, -1}, {-1, -1}, {1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+    const int first = pt == constants::ROOK ? 4 : 0;
+    const int last = pt == constants::BISHOP ? 4 : 8;
+
+    std::uint64_t rays[8][64] = {};
+    for (int d = first; d < last; ++d) {
+        for (int sq = 0; sq < 64; ++sq) {
+            int file = (sq & 7) + directions[d][0];
+            int rank = (sq >> 3) + directions[d][1];
+            while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                rays[d][sq] |= std::uint64_t(1) << (rank * 8 + file);
+                file += directions[d][0];
+                rank += directions[d][1];
             }
-
-            size++;
-            b = (b - m.mask) & m.mask;
-        } while (b);
-
-        if (has_pext) {
-            continue;
         }
+    }
 
-        PRNG rng(seeds[1][square.rank()]);
-
-        for (int i = 0; i < size;) {
-            for (m.magic = Bitboard(); Bitboard(((m.magic * m.mask) >> 56)).popcount() < 6;) {
-                m.magic = rng.sparse_rand<Bitboard>();
-            }
-
-            for (++cnt, i = 0; i < size; ++i) {
-                unsigned idx = m.index(occupancy[i]);
+    std::array<Bitboard, N> table{};
+    std::size_t offset = 0;
+    for (Square square = constants::A1; square <= constants::H8; ++square) {
+        const Magic m = magic_entry(pt, square);
 
-                if (epoch[idx] < cnt) {
-                    epoch[idx] = cnt;
-                    m.attacks[idx] = reference[i];
-                }
-                else if (m.attacks[idx] != reference[i]) {
-                    break;
+        // the carry-rippler visits the subsets of the mask in the same order PEXT numbers them,
+        // so we don't need the instruction itself to build the PEXT layout
+        const std::uint64_t mask = m.mask, magic = m.magic;
+        std::size_t size = 0;
+        std::uint64_t b = 0;
+        do {
+            std::uint64_t attacks = 0;
+            for (int d = first; d < last; ++d) {
+                std::uint64_t ray = rays[d][square];
+                std::uint64_t blockers = ray & b;
+                if (blockers) {
+                    // rays pointing up the board hit their lowest blocker first
+                    bool up = directions[d][1] > 0 || (directions[d][1] == 0 && directions[d][0] > 0);
+                    ray ^= rays[d][up ? __builtin_ctzll(blockers) : 63 - __builtin_clzll(blockers)];
                 }
-
+                attacks |= ray;
             }
 
-        }
+            std::size_t idx = has_pext ? size : std::size_t((b * magic) >> m.shift);
+            table[offset + idx] = Bitboard{attacks};
+            size++;
+            b = (b - mask) & mask;
+        } while (b);
 
+        offset += size;
     }
-
+    return table;
 }
 
-}
+}  // namespace init
 
 inline Bitboard rook_attacks(Square square, Bitboard occupancy) {
     return rook_magics[square].attacks[rook_magics[square].index(occupancy)];
@@ -680,7 +736,8 @@ inline Bitboard non_pawn_piece_type_attacks(PieceType piece_type,
 
 namespace init {
 
-inline std::array<std::array<Bitboard, 64>, 64> full_ray() {
+constexpr std::array<std::array<Bitboard, 64>, 64> full_ray() {
+    const auto bishop = bishop_attacks(), rook = rook_attacks();
     std::array<std::array<Bitboard, 64>, 64> full_ray_bb{};
     for (Square from = constants::A1; from <= constants::H8; ++from) {
         for (Square to = constants::A1; to <= constants::H8; ++to) {
@@ -694,21 +751,21 @@ inline std::array<std::array<Bitboard, 64>, 64> full_ray() {
                 low = to;
             }
             if (high.file() == low.file()) {
-                full_ray_bb[from][to] = (lookups::rook_attacks(high) & lookups::rook_attacks(low)) |
+                full_ray_bb[from][to] = (rook[high] & rook[low]) |
                                         Bitboard{from} | Bitboard{to};
             }
             if (high.rank() == low.rank()) {
-                full_ray_bb[from][to] = (lookups::rook_attacks(high) & lookups::rook_attacks(low)) |
+                full_ray_bb[from][to] = (rook[high] & rook[low]) |
                                         Bitboard{from} | Bitboard{to};
             }
             if (high.file() - low.file() == high.rank() - low.rank()) {
                 full_ray_bb[from][to] =
-                    (lookups::bishop_attacks(high) & lookups::bishop_attacks(low)) |
+                    (bishop[high] & bishop[low]) |
                     Bitboard{from} | Bitboard{to};
             }
             if (low.file() - high.file() == high.rank() - low.rank()) {
                 full_ray_bb[from][to] =
-                    (lookups::bishop_attacks(high) & lookups::bishop_attacks(low)) |
+                    (bishop[high] & bishop[low]) |
                     Bitboard{from} | Bitboard{to};
             }
         }
@@ -720,7 +777,7 @@ inline std::array<std::array<Bitboard, 64>, 64> full_ray() {
 
 }  // namespace init
 
-extern std::array<std::array<Bitboard, 64>, 64> FULL_RAY;
+extern const std::array<std::array<Bitboard, 64>, 64> FULL_RAY;
 
 inline Bitboard full_ray(Square from, Square to) {
     return FULL_RAY[from][to];
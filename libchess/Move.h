@@ -129,6 +129,21 @@ class Move {
         return move_str;
     }
 
+    // added by Krtoonbrat
+    // writes the move the same way as to_str without allocating, out needs room for 5 characters.
+    // returns the end of what was written
+    char* write(char* out) const {
+        *out++ = from_square().file().to_char();
+        *out++ = from_square().rank().to_char();
+        *out++ = to_square().file().to_char();
+        *out++ = to_square().rank().to_char();
+        auto promotion_pt = promotion_piece_type();
+        if (promotion_pt) {
+            *out++ = promotion_pt->to_char();
+        }
+        return out;
+    }
+
     constexpr bool operator==(const Move rhs) const {
         return value() == rhs.value();
     }
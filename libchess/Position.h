@@ -18,6 +18,7 @@
 #include "PieceType.h"
 #include "Square.h"
 #include "internal/Zobrist.h"
+#include "internal/Cuckoo.h"
 
 namespace libchess {
 
@@ -174,6 +175,16 @@ class Position {
 
     static constexpr int STATE_SIZE = 1000;
 
+    // added by Krtoonbrat
+    // material information that is updated incrementally in make_move instead of being counted from the bitboards
+    struct Material {
+        std::uint64_t key = 0;
+        int value[2] = {0, 0};
+        int non_pawn[2] = {0, 0};
+        std::uint8_t count[2][6] = {};
+        int pieces = 0;
+    };
+
     struct State {
         CastlingRights castling_rights_;
         std::optional<Square> enpassant_square_;
@@ -189,8 +200,10 @@ class Position {
         int staticEval = 0;
         PieceHistory *continuationHistory;
         int pliesSinceNull = 0;
+        int repetitions = 0; // how many times this position has occurred before, filled in by make_move
         NNUEdata nnue;
         bool ttPv = false;
+        Material material_;
     };
 
    public:
@@ -253,7 +266,7 @@ class Position {
     [[nodiscard]] std::optional<PieceType> piece_type_on(Square square) const;
     [[nodiscard]] std::optional<Color> color_of(Square square) const;
     [[nodiscard]] std::optional<Piece> piece_on(Square square) const;
-    [[nodiscard]] hash_type hash() const;
+    [[nodiscard]] hash_type hash() const; // this is also the polyglot key of the position
     [[nodiscard]] hash_type hashAfter(Move move);
     [[nodiscard]] hash_type pawn_hash() const;
     [[nodiscard]] Square king_square(Color color) const;
@@ -261,8 +274,15 @@ class Position {
     [[nodiscard]] int fullmoves() const;
     [[nodiscard]] bool in_check() const;
     [[nodiscard]] bool is_repeat(int times = 1) const;
+    [[nodiscard]] bool has_upcoming_repetition(int search_ply) const; // added by Krtoonbrat
+    [[nodiscard]] bool has_repeated() const; // added by Krtoonbrat
     [[nodiscard]] bool is_draw() const; // added by Krtoonbrat
     [[nodiscard]] int repeat_count() const;
+    [[nodiscard]] int material(Color color) const; // added by Krtoonbrat
+    [[nodiscard]] int non_pawn_material(Color color) const; // added by Krtoonbrat
+    [[nodiscard]] int piece_count() const; // added by Krtoonbrat
+    [[nodiscard]] int piece_count(PieceType piece_type, Color color) const; // added by Krtoonbrat
+    [[nodiscard]] hash_type material_hash() const; // added by Krtoonbrat
     [[nodiscard]] const std::string& start_fen() const;
     [[nodiscard]] GameState game_state() const;
 
@@ -428,7 +448,10 @@ protected:
             rights.disallow(constants::BLACK_QUEENSIDE);
         }
         //hash_value ^= zobrist::castling_rights_key(castling_rights());
-        hash_value ^= zobrist::side_to_move_key(side_to_move());
+        // only white to move is hashed, the same as polyglot and the incremental update in make_move
+        if (side_to_move() == constants::WHITE) {
+            hash_value ^= zobrist::side_to_move_key(constants::WHITE);
+        }
         return hash_value;
     }
     [[nodiscard]] hash_type calculate_pawn_hash() const {
@@ -443,6 +466,37 @@ protected:
         return hash_value;
     }
 
+    [[nodiscard]] Material calculate_material() const {
+        Material material;
+        for (Color c : constants::COLORS) {
+            for (PieceType pt : constants::PIECE_TYPES) {
+                int count = piece_type_bb(pt, c).popcount();
+                for (int i = 0; i < count; i++) {
+                    add_material(material, pt, c);
+                }
+            }
+        }
+        return material;
+    }
+
+    // the material key hashes the number of each piece, so the nth piece of a type uses the nth "square" key
+    static void add_material(Material& material, PieceType piece_type, Color color) {
+        material.key ^= zobrist::material_key(piece_type, color, material.count[color.value()][piece_type.value()]++);
+        material.value[color.value()] += pieceValuesMG[piece_type.value()];
+        if (piece_type != constants::PAWN && piece_type != constants::KING) {
+            material.non_pawn[color.value()] += pieceValuesMG[piece_type.value()];
+        }
+        material.pieces++;
+    }
+    static void remove_material(Material& material, PieceType piece_type, Color color) {
+        material.key ^= zobrist::material_key(piece_type, color, --material.count[color.value()][piece_type.value()]);
+        material.value[color.value()] -= pieceValuesMG[piece_type.value()];
+        if (piece_type != constants::PAWN && piece_type != constants::KING) {
+            material.non_pawn[color.value()] -= pieceValuesMG[piece_type.value()];
+        }
+        material.pieces--;
+    }
+
     void put_piece(Square square, PieceType piece_type, Color color) {
         Bitboard square_bb = Bitboard{square};
         piece_type_bb_[piece_type.value()] |= square_bb;
@@ -86,18 +86,66 @@ inline bool Position::in_check() const {
 }
 
 inline bool Position::is_repeat(int times) const {
+    return state().repetitions >= times;
+}
+
+// added by Krtoonbrat
+// checks if any position since the last irreversible move has already been seen, the tablebases need to know
+// because a repetition can use up the moves we have to win before the 50 move rule
+inline bool Position::has_repeated() const {
+    int end = std::min(halfmoves(), ply());
+    for (int i = 0; i <= end; i++) {
+        if (state(ply() - i).repetitions) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// added by Krtoonbrat, based on the Stockfish implementation
+// checks if the side to move has a reversible move that leads to a position we have already seen
+// search_ply is the distance from the root, repetitions before the root need to have happened twice to count
+inline bool Position::has_upcoming_repetition(int search_ply) const {
+    int end = std::min(halfmoves(), state().pliesSinceNull);
+    if (end < 3) {
+        return false;
+    }
+
     hash_type curr_hash = hash();
-    int num_keys = 0 > (ply() - halfmoves()) ? 0 : ply() - halfmoves();
-    num_keys = std::min(num_keys, ply() - state().pliesSinceNull);
-    int count = 0;
-    for (int i = ply() - 2; i >= num_keys; i -= 2) {
-        if (state(i).hash_ == curr_hash) {
-            ++count;
-            if (count >= times) {
-                return true;
+    for (int i = 3; i <= end; i += 2) {
+        const State& prev = state(ply() - i);
+        hash_type move_key = curr_hash ^ prev.hash_;
+
+        int j = cuckoo::h1(move_key);
+        if (cuckoo::keys[j] != move_key) {
+            j = cuckoo::h2(move_key);
+            if (cuckoo::keys[j] != move_key) {
+                continue;
             }
         }
+
+        // the move has to be possible on the current board
+        Move move = cuckoo::moves[j];
+        Square s1 = move.from_square();
+        Square s2 = move.to_square();
+        if (lookups::intervening(s1, s2) & occupancy_bb()) {
+            continue;
+        }
+
+        if (search_ply > i) {
+            return true;
+        }
+
+        // both directions of a move share a slot, so make sure it is our piece that would be moving
+        if (color_of(piece_on(s1) ? s1 : s2) != side_to_move()) {
+            continue;
+        }
+
+        if (prev.repetitions) {
+            return true;
+        }
     }
+
     return false;
 }
 
@@ -113,33 +161,53 @@ inline bool Position::is_draw() const {
     }
 
     // insufficient material
-    if (piece_type_bb(constants::PAWN) != 0
-        || piece_type_bb(constants::ROOK) != 0
-        || piece_type_bb(constants::QUEEN) != 0) {
+    // the material counts are kept up to date in make_move, so none of this touches the bitboards
+    // anything other than bishops beyond two kings and two knights can never be a material draw
+    const Material& material = state().material_;
+    if (material.pieces > 4 + material.count[0][constants::BISHOP] + material.count[1][constants::BISHOP]) {
         return false;
     }
 
-    if (piece_type_bb(constants::KNIGHT)) {
-        if (piece_type_bb(constants::BISHOP)) {
+    if (material.count[0][constants::PAWN] || material.count[1][constants::PAWN]
+        || material.count[0][constants::ROOK] || material.count[1][constants::ROOK]
+        || material.count[0][constants::QUEEN] || material.count[1][constants::QUEEN]) {
+        return false;
+    }
+
+    int knights = material.count[0][constants::KNIGHT] + material.count[1][constants::KNIGHT];
+    if (knights) {
+        if (material.count[0][constants::BISHOP] || material.count[1][constants::BISHOP]) {
             return false;
         }
 
-        return piece_type_bb(constants::KNIGHT).popcount() < 3;
+        return knights < 3;
     }
 
-    return piece_type_bb(constants::BISHOP, constants::WHITE).popcount() > 1 && piece_type_bb(constants::BISHOP, constants::BLACK).popcount() > 1;
+    return material.count[0][constants::BISHOP] > 1 && material.count[1][constants::BISHOP] > 1;
+}
+
+inline int Position::material(Color color) const {
+    return history_[ply() + 7].material_.value[color.value()];
+}
+
+inline int Position::non_pawn_material(Color color) const {
+    return history_[ply() + 7].material_.non_pawn[color.value()];
+}
+
+inline int Position::piece_count() const {
+    return history_[ply() + 7].material_.pieces;
+}
+
+inline int Position::piece_count(PieceType piece_type, Color color) const {
+    return history_[ply() + 7].material_.count[color.value()][piece_type.value()];
+}
+
+inline Position::hash_type Position::material_hash() const {
+    return history_[ply() + 7].material_.key;
 }
 
 inline int Position::repeat_count() const {
-    hash_type curr_hash = hash();
-    int num_keys = 0 > (ply() - halfmoves()) ? 0 : ply() - halfmoves();
-    int count = 0;
-    for (int i = ply() - 2; i >= num_keys; i -= 2) {
-        if (state(i).hash_ == curr_hash) {
-            ++count;
-        }
-    }
-    return count;
+    return state().repetitions;
 }
 
 inline const std::string& Position::start_fen() const {
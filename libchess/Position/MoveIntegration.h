@@ -388,6 +388,17 @@ inline void Position::make_move(Move move) {
 
     hash_type hash = prev_state.hash_;
     hash_type phash = prev_state.pawn_hash_;
+
+    // material only changes on captures and promotions
+    next_state.material_ = prev_state.material_;
+    if (captured_pt) {
+        remove_material(next_state.material_, *captured_pt, !stm);
+    }
+    if (promotion_pt) {
+        remove_material(next_state.material_, constants::PAWN, stm);
+        add_material(next_state.material_, *promotion_pt, stm);
+    }
+
     if (prev_state.enpassant_square_) {
         hash ^= zobrist::enpassant_key(*prev_state.enpassant_square_);
     }
@@ -568,6 +579,18 @@ inline void Position::make_move(Move move) {
     next_state.hash_ = hash;
     next_state.pawn_hash_ = phash;
 
+    // count the repetitions here so that draw detection doesn't have to walk the history at every node
+    // positions can only repeat every other ply, and never across an irreversible move or a null move
+    next_state.repetitions = 0;
+    int end = std::min(next_state.halfmoves_, next_state.pliesSinceNull);
+    for (int i = 4; i <= end; i += 2) {
+        const State& prev = state(ply_ - i);
+        if (prev.hash_ == hash) {
+            next_state.repetitions = prev.repetitions + 1;
+            break;
+        }
+    }
+
     assert(is_valid_position());
 }
 
@@ -598,6 +621,8 @@ inline void Position::make_null_move() {
     }
     // the pawn hash shouldn't change at all
     next.pawn_hash_ = prev.pawn_hash_;
+    next.material_ = prev.material_;
+    next.repetitions = 0;
 
     // update nnue data
     memcpy(&next.nnue.accumulator, &prev.nnue.accumulator, sizeof(Accumulator));
@@ -130,6 +130,7 @@ inline void Position::vflip() {
 
     state_mut_ref().hash_ = calculate_hash();
     state_mut_ref().pawn_hash_ = calculate_pawn_hash();
+    state_mut_ref().material_ = calculate_material();
 }
 
 inline std::optional<Move> Position::smallest_capture_move_to(Square square) const {
@@ -373,6 +374,12 @@ inline std::optional<Position> Position::from_fen(const std::string& fen) {
     fen_stream >> fen_part;
     curr_state.enpassant_square_ = Square::from(fen_part);
 
+    // make_move only keeps the enpassant square when it can be captured, so the hash (and polyglot) needs the same here
+    if (curr_state.enpassant_square_
+        && !(pos.piece_type_bb(constants::PAWN, pos.side_to_move_) & lookups::pawn_attacks(*curr_state.enpassant_square_, !pos.side_to_move_))) {
+        curr_state.enpassant_square_ = {};
+    }
+
     // Halfmoves
     fen_stream >> fen_part;
     const char* fen_part_cstr = fen_part.c_str();
@@ -386,6 +393,7 @@ inline std::optional<Position> Position::from_fen(const std::string& fen) {
 
     pos.state_mut_ref().hash_ = pos.calculate_hash();
     pos.state_mut_ref().pawn_hash_ = pos.calculate_pawn_hash();
+    pos.state_mut_ref().material_ = pos.calculate_material();
     pos.start_fen_ = fen;
 
     // nnue
@@ -474,6 +482,18 @@ inline bool Position::is_valid_position() {
         return false;
     }
 
+    // incrementally updated hash should match the one calculated from scratch
+    if (state().hash_ != calculate_hash()) {
+        std::cout << "Invalid hash" << std::endl;
+        return false;
+    }
+
+    // incrementally updated material should match the bitboards
+    if (state().material_.key != calculate_material().key) {
+        std::cout << "Invalid material" << std::endl;
+        return false;
+    }
+
     // no pieces on the same square
     for (PieceType p1 = constants::PAWN; p1 <= constants::KING; ++p1) {
         for (PieceType p2 = constants::PAWN; p2 <= constants::KING; ++p2) {
@@ -0,0 +1,83 @@
+#ifndef LIBCHESS_CUCKOO_H
+#define LIBCHESS_CUCKOO_H
+
+#include <array>
+#include <utility>
+
+#include "../Lookups.h"
+#include "../Move.h"
+#include "Zobrist.h"
+
+// added by Krtoonbrat
+// cuckoo hash tables of every reversible move, used to detect that a repetition can be reached in one move.
+// based on the Stockfish implementation of Marcel van Kervinck's algorithm
+namespace libchess::cuckoo {
+
+constexpr int SIZE = 8192;
+
+// the two hash functions used to index the tables
+constexpr int h1(std::uint64_t key) {
+    return int(key & 0x1fff);
+}
+constexpr int h2(std::uint64_t key) {
+    return int((key >> 16) & 0x1fff);
+}
+
+extern const std::array<std::uint64_t, SIZE> keys;
+extern const std::array<Move, SIZE> moves;
+
+namespace init {
+
+struct Tables {
+    std::array<std::uint64_t, SIZE> keys{};
+    std::array<Move, SIZE> moves{};
+};
+
+// the key of a move is the difference between the hashes before and after it was made
+constexpr Tables cuckoo() {
+    Tables tables;
+    const auto knight = lookups::init::knight_attacks();
+    const auto king = lookups::init::king_attacks();
+
+    for (Color c : constants::COLORS) {
+        for (PieceType pt : constants::PIECE_TYPES) {
+            if (pt == constants::PAWN) {
+                continue;
+            }
+            for (Square s1 = constants::A1; s1 <= constants::H8; ++s1) {
+                Bitboard attacks = pt == constants::KNIGHT ? knight[s1]
+                                 : pt == constants::KING   ? king[s1]
+                                 : lookups::init::sliding_attacks(pt, s1, Bitboard{});
+                for (Square s2 = s1 + 1; s2 <= constants::H8; ++s2) {
+                    if (!(attacks & Bitboard{s2})) {
+                        continue;
+                    }
+
+                    Move move{s1, s2};
+                    std::uint64_t key = zobrist::piece_square_key(s1, pt, c)
+                                      ^ zobrist::piece_square_key(s2, pt, c)
+                                      ^ zobrist::side_to_move_key(constants::WHITE);
+
+                    // insert the move, kicking out whatever was in the slot until we find an empty one
+                    int i = h1(key);
+                    while (true) {
+                        std::swap(tables.keys[i], key);
+                        std::swap(tables.moves[i], move);
+                        if (move.value() == 0) {
+                            break;
+                        }
+                        i = (i == h1(key)) ? h2(key) : h1(key);
+                    }
+                }
+            }
+        }
+    }
+
+    return tables;
+}
+
+}  // namespace init
+
+}  // namespace libchess::cuckoo
+
+#endif  // LIBCHESS_CUCKOO_H
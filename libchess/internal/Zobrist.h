@@ -20,6 +20,11 @@ constexpr inline std::uint64_t piece_square_key(Square square, PieceType piece_t
     }
     return polyglot::random_u64[piece_offset * 64 + square.value()];
 }
+// added by Krtoonbrat
+// the material key treats the piece count like a square, so the same table can be reused
+constexpr inline std::uint64_t material_key(PieceType piece_type, Color color, int count) {
+    return piece_square_key(Square{count}, piece_type, color);
+}
 constexpr inline std::uint64_t castling_rights_key(CastlingRights castling_rights) {
     if (castling_rights.is_allowed(constants::WHITE_KINGSIDE)) {
         return polyglot::random_u64[768 + 0];
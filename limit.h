@@ -5,6 +5,8 @@
 #ifndef ANDURIL_ENGINE_LIMIT_H
 #define ANDURIL_ENGINE_LIMIT_H
 
+#include <cstdint>
+
 struct limit {
     // time left on the clock for white and black (milliseconds)
     int time = -1;
@@ -19,7 +21,7 @@ struct limit {
     bool timeSet = false;
 
     // maximum number of nodes to search
-    int nodes = -1;
+    int64_t nodes = -1;
 };
 
 #endif //ANDURIL_ENGINE_LIMIT_H
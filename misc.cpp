@@ -15,6 +15,7 @@
 #endif
 
 #include <windows.h>
+#include <psapi.h>
 // The needed Windows API for processor groups could be missed from old Windows
 // versions, so instead of calling them directly (forcing the linker to resolve
 // the calls at compile time), try to load them at runtime. To do this we need
@@ -41,6 +42,10 @@ using fun8_t = bool (*)(HANDLE, BOOL, PTOKEN_PRIVILEGES, DWORD, PTOKEN_PRIVILEGE
     #include <stdlib.h>
 #endif
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 #include "incbin/incbin.h"
 INCBIN(InternalNNUE, "../egbdll/nets/nn-c157e0a5755b.nnue");
 
@@ -228,4 +233,35 @@ inline uint64_t byteSwap(uint64_t value) {
 #else
     return __builtin_bswap64(value);
 #endif
-}
\ No newline at end of file
+}
+
+// peak resident memory of the process, used for reporting by the book builder
+size_t peakMemoryUsage() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    // macOS reports bytes, linux reports kilobytes
+    return size_t(usage.ru_maxrss);
+#else
+    return size_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// minor and major faults of this thread, used to tell tablebase probes that had to touch a new page apart
+uint64_t threadPageFaults() {
+#if defined(RUSAGE_THREAD)
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return uint64_t(usage.ru_minflt) + uint64_t(usage.ru_majflt);
+#else
+    return 0;
+#endif
+}
@@ -30,5 +30,11 @@ void aligned_large_pages_free(void* ptr);
 // portable byteswap function used in libchess/Position/utilities.h
 uint64_t byteSwap(uint64_t value);
 
+// peak resident set size of the process in bytes
+size_t peakMemoryUsage();
+
+// page faults the calling thread has taken so far, always 0 where the system can't tell us
+uint64_t threadPageFaults();
+
 
 #endif //ANDURIL_ENGINE_MISC_H